@@ -0,0 +1,1592 @@
+// Squinewave oscillator core
+// by rasmus ekman
+//
+// Host-independent state machine, used by the SuperCollider Squine units.
+// No static or global mutable state: oscillators on different threads do not share memory.
+// Header-only, C++14. Optional defines:
+//   SQUINE_FAST_COS: polynomial cosine instead of libm cos()
+//   SQUINE_SIMD: SSE/NEON scan of the hardsync input
+//   SQUINE_STATS: per-instance counters of state machine paths (see oscillator::stats)
+//   SQUINE_ISA: name of an instruction set build, for hosts that link several (see below)
+
+#ifndef SQUINEWAVE_HPP
+#define SQUINEWAVE_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#elif defined(SQUINE_SIMD) && defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+/* With SQUINE_ISA, everything is in inline namespace squinewave::SQUINE_ISA. Builds for different instruction sets
+ * in one binary then get their own symbols, instead of the linker keeping one copy of each inline function for all.
+ */
+namespace squinewave {
+#ifdef SQUINE_ISA
+inline namespace SQUINE_ISA {
+#endif
+
+using std::cos;
+using std::fabs;
+using std::fmax;
+using std::fmin;
+using std::sin;
+
+constexpr double pi = 3.14159265358979323846;
+
+#ifdef SQUINE_STATS
+#define SQUINE_COUNT(counter, n) (counters.counter += (n))
+#else
+#define SQUINE_COUNT(counter, n) ((void)0)
+#endif
+
+// Forced inlining of the per-sample step into the block loops
+#if defined(__GNUC__)
+#define SQUINE_ALWAYS_INLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define SQUINE_ALWAYS_INLINE __forceinline
+#else
+#define SQUINE_ALWAYS_INLINE inline
+#endif
+
+/* ================================================================== */
+
+/* Flush-to-zero and denormals-are-zero on this thread while in scope (SSE MXCSR FTZ/DAZ, ARM64 FPCR FZ, else nothing).
+ * For hosts that build with fast math: shared libraries don't get its startup code that sets them.
+ * The control register is only written if the mode is off, and then restored, so other code on the thread keeps its mode.
+ */
+class denormals_off
+{
+#if defined(__SSE__) || defined(_M_X64)
+    enum : unsigned int { Mode = 0x8040 };  // FTZ | DAZ
+    const unsigned int saved = _mm_getcsr();
+    static void set(const unsigned int mode) { _mm_setcsr(mode); }
+#elif defined(__aarch64__) && defined(__GNUC__)
+    enum : uint64_t { Mode = uint64_t(1) << 24 };  // FZ, flushes inputs and results
+    const uint64_t saved = get();
+    static uint64_t get() { uint64_t mode; __asm__ __volatile__("mrs %0, fpcr" : "=r"(mode)); return mode; }
+    static void set(const uint64_t mode) { __asm__ __volatile__("msr fpcr, %0" : : "r"(mode)); }
+#else
+    enum { Mode = 0 };
+    const int saved = 0;
+    static void set(int) {}
+#endif
+public:
+    denormals_off() {
+        if ((saved & Mode) != Mode)
+            set(saved | Mode);
+    }
+    ~denormals_off() {
+        if ((saved & Mode) != Mode)
+            set(saved);
+    }
+};
+
+/* ================================================================== */
+
+/* True if all count values of sig equal sig[0] (never with NaN).
+ * Compares 16 samples per step (SSE/NEON with SQUINE_SIMD), and stops at the first step that differs,
+ * so a moving signal costs one step.
+ */
+inline bool is_constant(const float* sig, const int32_t count)
+{
+    const float first = sig[0];
+    int32_t i = 0;
+#if defined(SQUINE_SIMD) && (defined(__SSE__) || defined(_M_X64))
+    const __m128 value = _mm_set1_ps(first);
+    for (; i + 16 <= count; i += 16) {
+        const __m128 diff = _mm_or_ps(_mm_or_ps(_mm_cmpneq_ps(_mm_loadu_ps(sig + i), value), _mm_cmpneq_ps(_mm_loadu_ps(sig + i + 4), value)),
+                                      _mm_or_ps(_mm_cmpneq_ps(_mm_loadu_ps(sig + i + 8), value), _mm_cmpneq_ps(_mm_loadu_ps(sig + i + 12), value)));
+        if (_mm_movemask_ps(diff))
+            return false;
+    }
+#elif defined(SQUINE_SIMD) && defined(__ARM_NEON) && defined(__aarch64__)
+    const float32x4_t value = vdupq_n_f32(first);
+    for (; i + 16 <= count; i += 16) {
+        const uint32x4_t same = vandq_u32(vandq_u32(vceqq_f32(vld1q_f32(sig + i), value), vceqq_f32(vld1q_f32(sig + i + 4), value)),
+                                          vandq_u32(vceqq_f32(vld1q_f32(sig + i + 8), value), vceqq_f32(vld1q_f32(sig + i + 12), value)));
+        if (vminvq_u32(same) == 0)
+            return false;
+    }
+#endif
+    bool same = true;
+    for (; i < count; ++i) {
+        same &= (sig[i] == first);
+    }
+    return same;
+}
+
+/* Steepest step between neighbouring values of sig, from prev (the value before sig[0]),
+ * and the lowest magnitude of prev and sig. For the adaptive Min_Sweep scan of audio-rate freq.
+ * 4 samples per step with SQUINE_SIMD. A NaN input may be skipped, the oscillator clamps freq anyway.
+ */
+inline void get_slope(const float* sig, const int32_t count, const float prev, float& slope, float& lowest)
+{
+    float steepest = fabs(sig[0] - prev);
+    float low = fmin(fabs(prev), fabs(sig[0]));
+    int32_t i = 1;
+#if defined(SQUINE_SIMD) && (defined(__SSE__) || defined(_M_X64))
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 steep4 = _mm_set1_ps(steepest), low4 = _mm_set1_ps(low);
+    for (; i + 4 <= count; i += 4) {
+        const __m128 x = _mm_loadu_ps(sig + i);
+        steep4 = _mm_max_ps(steep4, _mm_andnot_ps(sign, _mm_sub_ps(x, _mm_loadu_ps(sig + i - 1))));
+        low4 = _mm_min_ps(low4, _mm_andnot_ps(sign, x));
+    }
+    steep4 = _mm_max_ps(steep4, _mm_movehl_ps(steep4, steep4));
+    low4 = _mm_min_ps(low4, _mm_movehl_ps(low4, low4));
+    steepest = _mm_cvtss_f32(_mm_max_ss(steep4, _mm_shuffle_ps(steep4, steep4, 1)));
+    low = _mm_cvtss_f32(_mm_min_ss(low4, _mm_shuffle_ps(low4, low4, 1)));
+#elif defined(SQUINE_SIMD) && defined(__ARM_NEON) && defined(__aarch64__)
+    float32x4_t steep4 = vdupq_n_f32(steepest), low4 = vdupq_n_f32(low);
+    for (; i + 4 <= count; i += 4) {
+        const float32x4_t x = vld1q_f32(sig + i);
+        steep4 = vmaxq_f32(steep4, vabdq_f32(x, vld1q_f32(sig + i - 1)));
+        low4 = vminq_f32(low4, vabsq_f32(x));
+    }
+    steepest = vmaxvq_f32(steep4);
+    low = vminvq_f32(low4);
+#endif
+    for (; i < count; ++i) {
+        const float step = fabs(sig[i] - sig[i - 1]);
+        const float magnitude = fabs(sig[i]);
+        steepest = (step > steepest) ? step : steepest;
+        low = (magnitude < low) ? magnitude : low;
+    }
+    slope = steepest;
+    lowest = low;
+}
+
+/* Allow either static value, or buffer-rate or audio-rate signal.
+ * Buffer-rate values are ramped over the block, linearly or with S-curve smoothing.
+ * The ramp is a closed-form cubic of sample position, with coefficients set once per block,
+ * so get_next() has no per-sample state or branches.
+ * Audio-rate blocks that hold one value throughout count as static (see is_constant()).
+ */
+template <typename Real>
+class input_param
+{
+    const float*  host_sig = nullptr;
+    bool          smooth = false;
+    Real          start = 0;
+    Real          target = 0;
+    // Ramp at sample n is start + k * (c1 + k * (c2 + k * c3)), with k = n + 1
+    Real          c1 = 0;
+    Real          c2 = 0;
+    Real          c3 = 0;
+public:
+     // Called at startup to declare host signal
+    void init(const float* host_sig_in, bool is_audiorate, bool smooth_in)
+    {
+        smooth = smooth_in;
+        if (is_audiorate) {
+            host_sig = host_sig_in;
+        }
+        else {
+            host_sig = nullptr;
+            start = target = host_sig_in[0];
+        }
+    }
+
+   // Called each process block to refresh host signal
+    void reinit(const float* host_sig_in, int sample_count)
+    {
+        if (host_sig) {
+            host_sig = host_sig_in;
+        }
+        else {
+            set_target(host_sig_in[0], sample_count);
+        }
+    }
+
+    // Ramp from previous target, reaching val at last sample of block
+    void set_target(Real val, int sample_count) {
+        start = target;
+        target = val;
+        const Real delta = target - start;
+        if (delta == 0) {
+            // Static value: no ramp, and no division
+            c1 = c2 = c3 = 0;
+            return;
+        }
+        const Real inv_count = Real(1) / sample_count;
+        if (smooth) {
+            // Smoothstep 3x^2 - 2x^3, x = k / sample_count
+            c1 = 0;
+            c2 = 3 * delta * inv_count * inv_count;
+            c3 = -2 * delta * inv_count * inv_count * inv_count;
+        }
+        else {
+            c1 = delta * inv_count;
+            c2 = c3 = 0;
+        }
+    }
+
+    // Host signal rate is known by the process function
+    template <bool AudioRate>
+    Real get_next(int n) const {
+        if (AudioRate) {
+            return host_sig[n];
+        }
+        const Real k = n + 1;
+        return start + k * (c1 + k * (c2 + k * c3));
+    }
+
+    // Latest control-rate value, or first value of audio-rate block
+    Real get_current() const {
+        return host_sig ? host_sig[0] : target;
+    }
+
+    // Control-rate value that does not ramp this block
+    bool is_static() const {
+        return !host_sig && start == target;
+    }
+
+    // Set the control-rate value reached, the next block ramps from it (no effect at audio rate)
+    void set_current(Real val) {
+        if (!host_sig) {
+            start = target = val;
+            c1 = c2 = c3 = 0;
+        }
+    }
+
+    // Value of a single-sample block, reached at once (the end of a one-sample ramp)
+    template <bool AudioRate>
+    Real get_single(const float* host_sig_in) {
+        if (AudioRate) {
+            host_sig = host_sig_in;
+        }
+        else {
+            start = target = host_sig_in[0];
+        }
+        return host_sig_in[0];
+    }
+
+    // Audio-rate block of one value, scans the block
+    bool is_constant(int sample_count) const {
+        return host_sig && squinewave::is_constant(host_sig, sample_count);
+    }
+};
+
+/* ================================================================== */
+
+/* Control values played in place from a host buffer (eg automation written by a sequencer), looping.
+ * next() advances by one block and returns the value at its end, linearly interpolated between frames.
+ * Fed to a control-rate input, the oscillator ramps to it over the block as to any control value,
+ * so automation resolution is one block. The host passes the buffer each block, it may change between blocks.
+ */
+class buffer_track
+{
+    double position = 0;  // in frames, range 0 to frames
+public:
+    // Channel 0 of interleaved frames (frames > 0) at the current position
+    float value(const float* data, const int32_t frames, const int32_t channels) const;
+
+    // Move by advance frames (any sign) and return value()
+    float next(const float* data, const int32_t frames, const int32_t channels, const double advance);
+
+    void reset() { position = 0; }
+};
+
+/* ================================================================== */
+
+/* One Squinewave oscillator. The host owns the signal buffers and calls process() per block.
+ *
+ * Real is the precision of shape math and parameter ramps (double or float).
+ * The phase accumulators phase and sweep_phase, and phase_inc that feeds them, stay double,
+ * since they integrate many small increments and float there would detune low frequencies.
+ */
+template <typename Real>
+class oscillator
+{
+public:
+    // Audio-rate input flags and sync output flag, selects process variant
+    enum {
+        Freq_AR = 1,
+        Clip_AR = 2,
+        Skew_AR = 4,
+        Sync_AR = 8,
+        Sync_Out = 16,
+        Num_Process_Variants = 32
+    };
+
+    /* Min_Sweep from user value: range 4-100, randomized if below (eg zero or -1).
+     * random() returns range 0-1, only called when needed.
+     */
+    template <typename Random>
+    static double pick_min_sweep(double requested, Random&& random);
+
+    // Set instance constants, min_sweep range 4-100
+    void init(const double sample_rate, const double min_sweep);
+
+    /* Adaptive Min_Sweep, after init(): each block picks Min_Sweep between the init() value and max_min_sweep
+     * (range up to 100) from the steepest freq slope, so deep FM keeps its sweeps long enough not to alias,
+     * and static or slow freq keeps the sharper init() value. 0 (or below the init() value) turns it off.
+     */
+    void init_adaptive(const double max_min_sweep);
+
+    /* Declare input signals before first process().
+     * Audio-rate inputs per flags, others are single control values (ramped, optionally smooth).
+     */
+    void init_inputs(const int flags, const float* freq_sig, const float* clip_sig, const float* skew_sig, const bool smooth);
+
+    // Init to part of waveform from user values, startphase range 0-2 (0 is top of curve)
+    void init_phase(double startphase, const double freq, const double clip, const double skew);
+
+    // Restart at startphase (as init_phase()) from the latest input values, ends any hardsync sweep
+    void reset_phase(double startphase);
+
+    /* Waveform position and control-rate input values, to restart or hand over a running voice
+     * without a new instance. Meaningful between oscillators of the same sample rate and Min_Sweep.
+     */
+    struct state
+    {
+        double phase;           // range 0-2
+        double sweep_phase;     // range 0-2
+        Real hardsync_phase;    // nonzero during hardsync sweep, range 0-pi
+        Real hardsync_inc;
+        Real freq;              // control-rate values reached, ignored at audio rate
+        Real clip;
+        Real skew;
+        bool neg_freq;          // waveform running backwards
+    };
+
+    state get_state() const;
+
+    // Continue from a state, clamped to valid ranges. Control-rate inputs ramp from its values over the next block.
+    void set_state(const state& s);
+
+    /* Render one block. Flags must match init_inputs, plus Sync_Out if sync_out is used.
+     * sync_sig only read if Sync_AR. sync_out gets 1.0 at each waveform wraparound, else 0.0.
+     */
+    template <int Flags>
+    void process(float* const sound_out, float* const sync_out, const int32_t nSamples,
+                 const float* freq_sig, const float* clip_sig, const float* skew_sig, const float* sync_sig);
+
+    /* Render a single-sample block, as process() with nSamples 1, without its block setup
+     * (ramps, constant and sync scans, run-length mode). For hosts running at block size 1,
+     * eg in feedback FM loops, or at control rate.
+     */
+    template <int Flags>
+    void process_sample(float* const sound_out, float* const sync_out,
+                        const float* freq_sig, const float* clip_sig, const float* skew_sig, const float* sync_sig);
+
+    /* Offline render of any length in one call, flags (as for process()) picked at run time.
+     * Inputs with their _AR flag are numSamples long, others are single values for the whole run.
+     * Runs process() over chunks of Render_Chunk samples: block size no longer matters.
+     */
+    void render(const int flags, float* sound_out, float* sync_out, const int64_t numSamples,
+                const float* freq_sig, const float* clip_sig, const float* skew_sig, const float* sync_sig);
+
+    enum { Render_Chunk = 1 << 20 };
+
+    // Shortest block where audio-rate inputs are scanned for a constant value (see process())
+    enum { Min_Constant_Block = 16 };
+
+    /* Static-shape fast paths (run-length mode, sweep table, rotation, cached geometry) on, the default, or off.
+     * Off, every block runs the per-sample state machine whatever its inputs, eg as a reference to test them against.
+     */
+    void set_fast_paths(const bool on) { fast_paths = on; }
+
+#ifdef SQUINE_STATS
+    /* Path counters, plain per-instance integers written only by process().
+     * Sample counts by segment include run-length samples, run_length counts the fast path share.
+     */
+    struct stats
+    {
+        uint64_t blocks;
+        uint64_t run_length;      // samples rendered by run_segment()
+        uint64_t pure_sine;       // samples above Max_Sweep_Freq
+        uint64_t sweep;           // samples on down or up sweeps
+        uint64_t flat;            // samples on flat -1 or +1 parts
+        uint64_t hardsync;        // samples with hardsync sweep ongoing
+        uint64_t sync_triggers;   // hardsync sweeps started
+        uint64_t sync_ignored;    // sync requests ignored: already syncing or freq above Max_Sync_Freq
+        uint64_t wraparounds;
+        uint64_t alias_resets;    // wraparounds with phase overshoot above phase_inc ("wild aliasing freq")
+        uint64_t zero_crossings;  // through-zero freq sign changes
+    };
+    enum { Num_Stats = sizeof(stats) / sizeof(uint64_t) };
+
+    const stats& get_stats() const { return counters; }
+    void reset_stats() { counters = stats(); }
+#endif
+
+private:
+    /* Waveform segment sizes while freq/clip/skew don't change.
+     * Same values as computed per sample in process(), with the sweep divisions done once.
+     */
+    struct segment_geometry
+    {
+        double phase_inc;
+        Real midpoint;
+        Real sweep_inc_1;
+        Real sweep_inc_2;
+        // Rotation by pi * sweep_inc per sample, see rotate_sweep()
+        double step_cos_1, step_sin_1;
+        double step_cos_2, step_sin_2;
+        bool pure_sine;
+    };
+
+    // Freq sign over a block: the same as neg_freq for all samples, or crossing zero
+    enum { Freq_Crossing, Freq_Positive, Freq_Negative };
+    template <bool AudioRate>
+    int get_freq_sign(const float* freq_sig, const int32_t nSamples) const;
+
+    template <int Flags, int Sign>
+    bool next_sample(float* const sound_out, float* const sync_out, const int32_t i,
+                     const Real raw_freq, const Real clip, Real skew, const bool sync_now);
+
+    void init_geometry(segment_geometry& geometry, const Real raw_freq, const Real clip, Real skew) const;
+    const segment_geometry& get_geometry(const Real raw_freq, const Real clip, const Real skew);
+    int32_t run_segment(float* sound_out, int32_t i, const int32_t end, const segment_geometry& geometry);
+    // Sweeps long enough to pay for starting a cos/sin pair (about 50 samples of sweep_table reads), or continuing one
+    bool use_rotation(const double sweep_phase, const double limit, const Real sweep_inc) const {
+        enum { Min_Rotation = 64 };
+        return sweep_phase == rotation_phase || limit - sweep_phase >= Min_Rotation * sweep_inc;
+    }
+    template <bool Inclusive>
+    int32_t rotate_sweep(float* sound_out, int32_t i, const int32_t end, const double limit, const Real sweep_inc,
+                         const double step_cos, const double step_sin, const double phase_inc, double& phase, double& sweep_phase);
+
+    template <int... Flags>
+    void render_variant(const int flags, float* sound_out, float* sync_out, const int32_t nSamples,
+                        const float* freq_sig, const float* clip_sig, const float* skew_sig, const float* sync_sig,
+                        std::integer_sequence<int, Flags...>);
+
+    void set_phase(const double phase_in, const double freq, const double clip, const double skew);
+    void set_min_sweep(const double min_sweep);
+    template <bool AudioRate>
+    void adapt_min_sweep(const float* freq_sig, const int32_t nSamples);
+    void hardsync_init(const Real freq, const double sweep_phase);
+
+    // Input variables
+    input_param<Real> freq_param;
+    input_param<Real> clip_param;
+    input_param<Real> skew_param;
+    bool neg_freq = false;
+
+    // phase and sweep_phase range 0-2. This makes skew/clip into simple proportions
+    double phase = 0;
+    double sweep_phase = 0;
+    Real hardsync_phase = 0;
+    Real hardsync_inc = 0;
+
+    // Geometry of static blocks, kept until freq/clip/skew change (clip is 0-1, so -1 is never matched)
+    segment_geometry geometry = segment_geometry();
+    Real geometry_freq = 0;
+    Real geometry_clip = -1;
+    Real geometry_skew = 0;
+
+    // cos and sin of pi * rotation_phase, carried over blocks while a static sweep goes on
+    double rotation_phase = -1;
+    double rotation_cos = 0;
+    double rotation_sin = 0;
+
+    bool fast_paths = true;
+
+    // Adaptive Min_Sweep range (Adapt_Max 0 when off), and its unquantized value and last freq input
+    enum { Adapt_Steps = 32 };  // Grid of adapted values, steps per sample
+    Real Adapt_Base = 0;
+    Real Adapt_Max = 0;
+    Real adapt_min_sweep_value = 0;
+    Real adapt_freq = 0;
+
+    // Instance constants inited from environment (Min_Sweep and the sweep/sync limits change per block if adaptive)
+    double Sample_Rate;
+    Real Min_Sweep;
+    double Maxphase_By_sr;
+    Real Max_Sweep_Freq;
+    Real Max_Sweep_Inc;
+    Real Max_Sync_Freq;
+    Real Sync_Phase_Inc;
+
+#ifdef SQUINE_STATS
+    stats counters = stats();
+#endif
+};
+
+/* ================================================================== */
+
+/* NaN test on the bit pattern (exponent all ones, mantissa nonzero).
+ * Unlike x != x or std::isnan(), it can't be optimized away under -ffast-math or -ffinite-math-only.
+ */
+inline bool is_nan(const float x) {
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return (bits & 0x7fffffffu) > 0x7f800000u;
+}
+
+inline bool is_nan(const double x) {
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return (bits & 0x7fffffffffffffffull) > 0x7ff0000000000000ull;
+}
+
+// Returns maxval on NaN or +Inf, minval on -Inf. Safe in fast-math builds (see is_nan).
+template <typename Real>
+inline Real Clamp(const Real x, const Real minval, const Real maxval) {
+    return is_nan(x) ? maxval : (x < minval) ? minval : (x > maxval) ? maxval : x;
+}
+
+inline float buffer_track::value(const float* data, const int32_t frames, const int32_t channels) const {
+    const int32_t index = static_cast<int32_t>(position);
+    const float frac = static_cast<float>(position - index);
+    const int32_t next_index = (index + 1 < frames) ? index + 1 : 0;
+    const float x0 = data[int64_t(index) * channels];
+    const float x1 = data[int64_t(next_index) * channels];
+    return x0 + frac * (x1 - x0);
+}
+
+inline float buffer_track::next(const float* data, const int32_t frames, const int32_t channels, const double advance) {
+    position += advance;
+    if (position < 0 || position >= frames) {
+        position -= std::floor(position / frames) * frames;
+    }
+    // NaN or infinite advance, and rounding up to frames (see is_nan() on fast-math builds)
+    if (is_nan(position) || position < 0 || position >= frames) {
+        position = 0;
+    }
+    return value(data, frames, channels);
+}
+
+/* sin(pi * y) on y = -0.5..0.5, odd minimax polynomial degree 9, max abs error 3.4e-9.
+ * T may also be a vector of Scalar lanes (SquineBank).
+ */
+template <typename T, typename Scalar = T>
+inline T sin_pi_poly(const T y) {
+    const T y2 = y * y;
+    return y * (Scalar(3.1415925800447417) + y2 * (Scalar(-5.1677068789272012) + y2 * (Scalar(2.5500313772919081)
+             + y2 * (Scalar(-0.59804517418238312) + y2 * Scalar(0.077220129059469303)))));
+}
+
+/* cos(pi * x) for the sweeps, x range 0-2 (any value works).
+ * With SQUINE_FAST_COS a branch-free polynomial: reduced by symmetry to sin(pi * y) on y = -0.5..0.5,
+ * odd minimax polynomial degree 9, max abs error 3.4e-9. That is below float output resolution
+ * (0.06 ulp at 1.0), and about twice the throughput of libm cos().
+ */
+template <typename Real>
+inline Real cos_pi(Real x) {
+#ifdef SQUINE_FAST_COS
+    x = fabs(x);
+    x -= 2 * static_cast<Real>(static_cast<int64_t>(x * Real(0.5)));
+    x = (x > 1) ? 2 - x : x;
+    return sin_pi_poly(Real(0.5) - x);
+#else
+    return cos(Real(pi) * x);
+#endif
+}
+
+// cos(x) for hardsync_phase, range 0-pi
+template <typename Real>
+inline Real cos_rad(const Real x) {
+#ifdef SQUINE_FAST_COS
+    return cos_pi(x * Real(1.0 / pi));
+#else
+    return cos(x);
+#endif
+}
+
+/* Read-only table of cos(pi * x), x range 0-1, for the run-length mode of static shapes.
+ * Every sweep is the same half cosine in sweep_phase units, whatever freq/clip/skew and Min_Sweep,
+ * so one table serves all geometries. Linear interpolation, max abs error 7.4e-8 (about float resolution).
+ * Built on first call: hosts should call table() once at load, before any audio thread.
+ */
+template <typename Real>
+class sweep_table
+{
+    enum { Size = 4096 };
+    Real values[Size + 2];
+
+    sweep_table() {
+        for (int i = 0; i < Size + 2; ++i)
+            values[i] = cos(pi * i / Size);
+    }
+
+public:
+    static const sweep_table& table() {
+        static const sweep_table instance;
+        return instance;
+    }
+
+    // cos(pi * x), x range 0-2
+    Real cos_pi(Real x) const {
+        x = (x > 1) ? 2 - x : x;
+        const Real pos = x * Size;
+        const int32_t index = static_cast<int32_t>(pos);
+        const Real frac = pos - index;
+        return values[index] + frac * (values[index + 1] - values[index]);
+    }
+};
+
+// Inverted to get proportion flat parts
+template <typename Real>
+inline Real get_clip(const Real x) {
+    return 1 - Clamp<Real>(x, 0, 1);
+}
+
+// Rescaled to 0-2, to match phase
+template <typename Real>
+inline Real get_skew(const Real x) {
+    return 1 - Clamp<Real>(x, -1, 1);
+}
+
+/* Start values of phase and sweep_phase for init phase phase_in, with shortest sweep min_sweep
+ * (phase_inc * Min_Sweep) and clip/skew as from get_clip/get_skew. Shared with hosts that keep their own voice state (SquineBank).
+ */
+inline void start_phase(const double phase_in, const double min_sweep, const double clip, const double skew,
+                        double& phase_out, double& sweep_phase_out) {
+    const double midpoint = Clamp(skew, min_sweep, 2.0 - min_sweep);
+
+    // Init phase range 0-2, has 4 segment parts (sweep down, flat -1, sweep up, flat +1)
+    double phase = 0.0;
+    double sweep_phase = (phase_in >= 0.0)? phase_in : 1.25;  // "up" 0-crossing
+    if (sweep_phase > 2.0)
+        sweep_phase = fmod(sweep_phase, 2.0);
+
+    // Select segment and scale within
+    if (sweep_phase < 1.0) {
+        const double sweep_length = fmax(clip * midpoint, min_sweep);
+        if (sweep_phase < 0.5) {
+            phase = sweep_length * (sweep_phase * 2.0);
+            sweep_phase *= 2.0;
+        }
+        else {
+            const double flat_length = midpoint - sweep_length;
+            phase = sweep_length + flat_length * ((sweep_phase - 0.5) * 2.0);
+            sweep_phase = 1.0;
+        }
+    }
+    else {
+        const double sweep_length = fmax(clip * (2.0 - midpoint), min_sweep);
+        if (sweep_phase < 1.5) {
+            phase = midpoint + sweep_length * ((sweep_phase - 1.0) * 2.0);
+            sweep_phase = 1.0 + (sweep_phase - 1.0) * 2.0;
+        }
+        else {
+            const double flat_length = 2.0 - (midpoint + sweep_length);
+            phase = midpoint + sweep_length + flat_length * ((sweep_phase - 1.5) * 2.0);
+            sweep_phase = 2.0;
+        }
+    }
+    phase_out = phase;
+    sweep_phase_out = sweep_phase;
+}
+
+/* ================================================================== */
+
+template <typename Real>
+template <typename Random>
+double oscillator<Real>::pick_min_sweep(double requested, Random&& random) {
+    if (requested < 4 || requested > 99) {
+        // Random value range 5-10
+        if (requested < 4)
+            requested = Clamp(5 * random() + 5, 5.0, 10.0);
+        else
+            requested = 100;
+    }
+    return requested;
+}
+
+template <typename Real>
+void oscillator<Real>::init(const double sr, const double min_sweep) {
+    Sample_Rate = sr;
+    Maxphase_By_sr = 2.0 / sr;
+    Adapt_Max = 0;
+    set_min_sweep(min_sweep);
+}
+
+template <typename Real>
+void oscillator<Real>::init_adaptive(const double max_min_sweep) {
+    Adapt_Base = Min_Sweep;
+    Adapt_Max = (max_min_sweep > Min_Sweep) ? fmin(max_min_sweep, 100.0) : 0;
+    adapt_min_sweep_value = Min_Sweep;
+    adapt_freq = freq_param.get_current();
+}
+
+// Min_Sweep and the limits that follow from it. Cached geometry is dropped, it depends on them.
+template <typename Real>
+void oscillator<Real>::set_min_sweep(const double min_sweep) {
+    const double sr = Sample_Rate;
+    Min_Sweep = min_sweep;
+    Max_Sweep_Freq = sr / (2.0 * Min_Sweep);      // range sr/8 - sr/200
+    Max_Sweep_Inc = 1.0 / Min_Sweep;
+    // log() doesn't show in a voice start (init_phase() and the first block dominate), so no table
+    Max_Sync_Freq = sr / (3.0 * log(Min_Sweep));  // range sr/4.1 - sr/13.8
+    Sync_Phase_Inc = 1.0 / log(Min_Sweep);
+    geometry_clip = -1;
+}
+
+/* Adaptive Min_Sweep from the block's steepest freq slope (per sample, from the last input of the previous block)
+ * and its lowest |freq|. A sweep of M samples at freq f, while freq rises by slope per sample,
+ * shortens to about M * f / (f + slope * M / 2). So M = Base / (1 - Base * slope / (2 * f)) keeps it at Base length,
+ * beyond that (eg through-zero FM) Adapt_Max. Rises at once, falls back over about 8 blocks.
+ * Values are kept on a grid of 1/Adapt_Steps samples, so the limits (and their log()) are only recomputed on a grid step.
+ */
+template <typename Real>
+template <bool AudioRate>
+void oscillator<Real>::adapt_min_sweep(const float* freq_sig, const int32_t nSamples) {
+    Real slope = 0;
+    Real lowest = 0;
+    if (AudioRate) {
+        float steepest, low;
+        get_slope(freq_sig, nSamples, static_cast<float>(adapt_freq), steepest, low);
+        slope = steepest;
+        lowest = low;
+        adapt_freq = freq_sig[nSamples - 1];
+    }
+    else {
+        // Linear ramp to the block value (a smooth ramp peaks at 1.5 times this slope)
+        const Real f = freq_param.get_current();
+        slope = fabs(f - adapt_freq) / nSamples;
+        lowest = ((f < 0) != (adapt_freq < 0)) ? 0 : fmin(fabs(f), fabs(adapt_freq));
+        adapt_freq = f;
+    }
+
+    const Real shortening = Adapt_Base * slope;
+    Real wanted = Adapt_Base;
+    if (slope > 0)
+        wanted = (shortening < 2 * lowest) ? fmin(2 * lowest * Adapt_Base / (2 * lowest - shortening), Adapt_Max) : Adapt_Max;
+
+    Real& value = adapt_min_sweep_value;
+    value = (wanted >= value) ? wanted : value + (wanted - value) * Real(0.125);
+    // Back at Base once within half a grid step, Base itself may be off the grid
+    const double next = (value - Adapt_Base < Real(0.5) / Adapt_Steps) ? double(Adapt_Base)
+                                                                       : std::floor(double(value) * Adapt_Steps + 0.5) / Adapt_Steps;
+    if (next != Min_Sweep)
+        set_min_sweep(next);
+}
+
+template <typename Real>
+void oscillator<Real>::init_inputs(const int flags, const float* freq_sig, const float* clip_sig, const float* skew_sig, const bool smooth) {
+    freq_param.init(freq_sig, (flags & Freq_AR) != 0, smooth);
+    clip_param.init(clip_sig, (flags & Clip_AR) != 0, smooth);
+    skew_param.init(skew_sig, (flags & Skew_AR) != 0, smooth);
+    neg_freq = (freq_sig[0] < 0);
+}
+
+template <typename Real>
+void oscillator<Real>::init_phase(double startphase, const double freq, const double clip, const double skew) {
+    // Init phase range 0-2 (which is wraparaound)
+    if (startphase) {
+        startphase = (startphase < 0 || startphase > 2.0) ? 1.25 : startphase;
+    }
+    set_phase(startphase, fabs(freq), get_clip<Real>(clip), get_skew<Real>(skew));
+}
+
+template <typename Real>
+void oscillator<Real>::reset_phase(const double startphase) {
+    init_phase(startphase, freq_param.get_current(), clip_param.get_current(), skew_param.get_current());
+    hardsync_phase = hardsync_inc = 0;
+    rotation_phase = -1;
+}
+
+template <typename Real>
+typename oscillator<Real>::state oscillator<Real>::get_state() const {
+    state s;
+    s.phase = phase;
+    s.sweep_phase = sweep_phase;
+    s.hardsync_phase = hardsync_phase;
+    s.hardsync_inc = hardsync_inc;
+    s.freq = freq_param.get_current();
+    s.clip = clip_param.get_current();
+    s.skew = skew_param.get_current();
+    s.neg_freq = neg_freq;
+    return s;
+}
+
+template <typename Real>
+void oscillator<Real>::set_state(const state& s) {
+    phase = Clamp(s.phase, 0.0, 2.0);
+    sweep_phase = Clamp(s.sweep_phase, 0.0, 2.0);
+    hardsync_phase = Clamp<Real>(s.hardsync_phase, 0, pi);
+    hardsync_inc = hardsync_phase ? Clamp<Real>(s.hardsync_inc, 0, Sync_Phase_Inc) : 0;
+    freq_param.set_current(s.freq);
+    clip_param.set_current(s.clip);
+    skew_param.set_current(s.skew);
+    neg_freq = s.neg_freq;
+    // Rotation pair belongs to the old sweep_phase
+    rotation_phase = -1;
+}
+
+/* ================================================================== */
+
+// Set main phase so it matches sweep_phase
+template <typename Real>
+void oscillator<Real>::set_phase(const double phase_in, const double freq, const double clip, const double skew) {
+    const double phase_inc = Maxphase_By_sr * freq;
+    start_phase(phase_in, phase_inc * Min_Sweep, clip, skew, phase, sweep_phase);
+}
+
+template <typename Real>
+void oscillator<Real>::init_geometry(segment_geometry& geometry, const Real raw_freq, const Real clip, Real skew) const {
+    const Real freq = fabs(raw_freq);
+    if (raw_freq < 0) {
+        skew = Clamp<Real>(2 - skew, 0, 2);
+    }
+    const double phase_inc = Maxphase_By_sr * freq;
+    const Real min_sweep = phase_inc * Min_Sweep;
+    const Real midpoint = Clamp<Real>(skew, min_sweep, 2 - min_sweep);
+    const Real sweep_length_1 = fmax(clip * midpoint, min_sweep);
+    const Real sweep_length_2 = fmax(clip * (2 - midpoint), min_sweep);
+
+    geometry.phase_inc = phase_inc;
+    geometry.midpoint = midpoint;
+    geometry.sweep_inc_1 = fmin(phase_inc / sweep_length_1, Max_Sweep_Inc);
+    geometry.sweep_inc_2 = fmin(phase_inc / sweep_length_2, Max_Sweep_Inc);
+    geometry.step_cos_1 = cos(pi * geometry.sweep_inc_1);
+    geometry.step_sin_1 = sin(pi * geometry.sweep_inc_1);
+    geometry.step_cos_2 = cos(pi * geometry.sweep_inc_2);
+    geometry.step_sin_2 = sin(pi * geometry.sweep_inc_2);
+    geometry.pure_sine = (freq >= Max_Sweep_Freq);
+}
+
+template <typename Real>
+template <bool AudioRate>
+int oscillator<Real>::get_freq_sign(const float* freq_sig, const int32_t nSamples) const {
+    int32_t negatives = 0;
+    int32_t count = nSamples;
+    if (AudioRate) {
+        for (int32_t i = 0; i < nSamples; ++i)
+            negatives += (freq_sig[i] < 0);
+    }
+    else {
+        // Ramp is monotonic, so its ends have its extremes
+        negatives = (freq_param.template get_next<false>(0) < 0) + (freq_param.template get_next<false>(nSamples - 1) < 0);
+        count = 2;
+    }
+    if (negatives == 0 && !neg_freq)
+        return Freq_Positive;
+    if (negatives == count && neg_freq)
+        return Freq_Negative;
+    return Freq_Crossing;
+}
+
+// Geometry for static shape, only computed again when a control value has changed
+template <typename Real>
+const typename oscillator<Real>::segment_geometry& oscillator<Real>::get_geometry(const Real raw_freq, const Real clip, const Real skew) {
+    if (raw_freq != geometry_freq || clip != geometry_clip || skew != geometry_skew) {
+        init_geometry(geometry, raw_freq, clip, skew);
+        geometry_freq = raw_freq;
+        geometry_clip = clip;
+        geometry_skew = skew;
+    }
+    return geometry;
+}
+
+/* ================================================================== */
+
+/* Run-length mode for static freq/clip/skew and no hardsync.
+ * Fills samples of current segment with tight loops, while the next sample is known
+ * to stay inside the segment. Segment ends are left to the full state machine in process().
+ * Same phase arithmetic as process(), sweeps are read from sweep_table or rotated (see rotate_sweep())
+ * instead of cos(), so moving parameters switch back to the state machine without a step.
+ */
+template <typename Real>
+int32_t oscillator<Real>::run_segment(float* sound_out, int32_t i, const int32_t end, const segment_geometry& geometry) {
+    const sweep_table<Real>& sweep = sweep_table<Real>::table();
+    const double phase_inc = geometry.phase_inc;
+    double phase = this->phase;
+    double sweep_phase = this->sweep_phase;
+#ifdef SQUINE_STATS
+    const int32_t first = i;
+#endif
+
+    if (geometry.pure_sine) {
+        while (i < end && sweep_phase + phase_inc < 2.0) {
+            sound_out[i++] = static_cast<float>( sweep.cos_pi(sweep_phase) );
+            phase = sweep_phase + phase_inc;
+            sweep_phase = phase;
+        }
+        SQUINE_COUNT(pure_sine, i - first);
+    }
+    else if (sweep_phase < 1.0) {
+        const Real sweep_inc = geometry.sweep_inc_1;
+        if (use_rotation(sweep_phase, 1.0, sweep_inc)) {
+            i = rotate_sweep<true>(sound_out, i, end, 1.0, sweep_inc, geometry.step_cos_1, geometry.step_sin_1, phase_inc, phase, sweep_phase);
+        }
+        while (i < end && sweep_phase + sweep_inc <= 1.0) {
+            sound_out[i++] = static_cast<float>( sweep.cos_pi(sweep_phase) );
+            sweep_phase += sweep_inc;
+            phase += phase_inc;
+        }
+        SQUINE_COUNT(sweep, i - first);
+    }
+    else if (sweep_phase == 1.0 && phase < geometry.midpoint) {
+        const Real midpoint = geometry.midpoint;
+        while (i < end && phase < midpoint) {
+            sound_out[i++] = -1.0;
+            phase += phase_inc;
+        }
+        SQUINE_COUNT(flat, i - first);
+    }
+    else if (sweep_phase < 2.0) {
+        // Sweep start after flat part is left to process()
+        const Real sweep_inc = geometry.sweep_inc_2;
+        if (sweep_phase != 1.0) {
+            if (use_rotation(sweep_phase, 2.0, sweep_inc)) {
+                i = rotate_sweep<false>(sound_out, i, end, 2.0, sweep_inc, geometry.step_cos_2, geometry.step_sin_2, phase_inc, phase, sweep_phase);
+            }
+            while (i < end && sweep_phase + sweep_inc < 2.0) {
+                sound_out[i++] = static_cast<float>( sweep.cos_pi(sweep_phase) );
+                sweep_phase += sweep_inc;
+                phase += phase_inc;
+            }
+        }
+        SQUINE_COUNT(sweep, i - first);
+    }
+    else {
+        while (i < end && phase + phase_inc < 2.0) {
+            sound_out[i++] = 1.0;
+            phase += phase_inc;
+        }
+        sweep_phase = 2.0;
+        SQUINE_COUNT(flat, i - first);
+    }
+    SQUINE_COUNT(run_length, i - first);
+
+    this->phase = phase;
+    this->sweep_phase = sweep_phase;
+    return i;
+}
+
+/* Sweep of run-length mode, while the next sweep_phase stays below limit (or at limit if Inclusive).
+ * sweep_phase moves by a constant sweep_inc, so cos(pi * sweep_phase) advances by rotating a cos/sin pair
+ * by pi * sweep_inc instead of a table read, in double whatever Real is. Even and odd samples are two
+ * chains rotated by twice the step, so their multiplies overlap. The pair is computed exactly when a sweep
+ * starts (or process() moved sweep_phase), and carried over blocks while the sweep goes on.
+ * Rounding grows about 1e-16 per sample, far below float output resolution (the table is 7.4e-8).
+ */
+template <typename Real>
+template <bool Inclusive>
+int32_t oscillator<Real>::rotate_sweep(float* sound_out, int32_t i, const int32_t end, const double limit, const Real sweep_inc,
+                                       const double step_cos, const double step_sin, const double phase_inc,
+                                       double& phase, double& sweep_phase) {
+    double c = rotation_cos, s = rotation_sin;
+    if (sweep_phase != rotation_phase) {
+        c = cos(pi * sweep_phase);
+        s = sin(pi * sweep_phase);
+    }
+    const double step2_cos = step_cos * step_cos - step_sin * step_sin;
+    const double step2_sin = 2 * step_cos * step_sin;
+    double c_odd = c * step_cos - s * step_sin;
+    double s_odd = s * step_cos + c * step_sin;
+    while (i < end && (Inclusive ? sweep_phase + sweep_inc <= limit : sweep_phase + sweep_inc < limit)) {
+        sound_out[i++] = static_cast<float>(c);
+        sweep_phase += sweep_inc;
+        phase += phase_inc;
+        if (!(i < end && (Inclusive ? sweep_phase + sweep_inc <= limit : sweep_phase + sweep_inc < limit))) {
+            c = c_odd;
+            s = s_odd;
+            break;
+        }
+        sound_out[i++] = static_cast<float>(c_odd);
+        sweep_phase += sweep_inc;
+        phase += phase_inc;
+        const double next_c = c * step2_cos - s * step2_sin;
+        s = s * step2_cos + c * step2_sin;
+        c = next_c;
+        const double next_c_odd = c_odd * step2_cos - s_odd * step2_sin;
+        s_odd = s_odd * step2_cos + c_odd * step2_sin;
+        c_odd = next_c_odd;
+    }
+    rotation_phase = sweep_phase;
+    rotation_cos = c;
+    rotation_sin = s;
+    return i;
+}
+
+/* ================================================================== */
+
+/* Hardsync trigger positions (sync >= 1.0) of one block, found 64 samples at a time.
+ * Each chunk is scanned once into a bitmask (vector compare and movemask with SQUINE_SIMD),
+ * and find() walks its set bits. So the search for next trigger after a hardsync wraparound
+ * does not read the sync signal again.
+ */
+class sync_triggers
+{
+    enum { Chunk_Size = 64 };
+
+    const float* sync_sig;
+    const int32_t size;
+    int32_t base = -Chunk_Size;  // first sample of scanned chunk
+    uint64_t bits = 0;           // bit n set if trigger at base + n
+
+    static uint64_t scan_chunk(const float* sig, const int32_t count);
+    static int32_t lowest_bit(uint64_t x);
+
+public:
+    sync_triggers(const float* sync_sig, const int32_t size) : sync_sig(sync_sig), size(size) {}
+
+    // First trigger at or after sample first, or -1 if none
+    int32_t find(int32_t first)
+    {
+        for (; first < size; first = base + Chunk_Size) {
+            if (first < base || first >= base + Chunk_Size) {
+                base = first & ~(Chunk_Size - 1);
+                const int32_t count = (size - base < Chunk_Size) ? size - base : Chunk_Size;
+                bits = scan_chunk(sync_sig + base, count);
+            }
+            const uint64_t pending = bits & (~uint64_t(0) << (first - base));
+            if (pending)
+                return base + lowest_bit(pending);
+        }
+        return -1;
+    }
+};
+
+inline uint64_t sync_triggers::scan_chunk(const float* sig, const int32_t count)
+{
+    uint64_t bits = 0;
+    int32_t i = 0;
+#if defined(SQUINE_SIMD) && (defined(__SSE__) || defined(_M_X64))
+    const __m128 one = _mm_set1_ps(1.0f);
+    for (; i + 4 <= count; i += 4) {
+        const uint64_t mask = _mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(sig + i), one));
+        bits |= mask << i;
+    }
+#elif defined(SQUINE_SIMD) && defined(__ARM_NEON) && defined(__aarch64__)
+    const uint32x4_t weights = { 1, 2, 4, 8 };
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    for (; i + 4 <= count; i += 4) {
+        const uint64_t mask = vaddvq_u32(vandq_u32(vcgeq_f32(vld1q_f32(sig + i), one), weights));
+        bits |= mask << i;
+    }
+#endif
+    for (; i < count; ++i) {
+        bits |= uint64_t(sig[i] >= 1.0f) << i;
+    }
+    return bits;
+}
+
+inline int32_t sync_triggers::lowest_bit(uint64_t x)
+{
+#ifdef __GNUC__
+    return __builtin_ctzll(x);
+#else
+    int32_t n = 0;
+    for (; !(x & 1); x >>= 1)
+        ++n;
+    return n;
+#endif
+}
+
+template <typename Real>
+void oscillator<Real>::hardsync_init(const Real freq, const double sweep_phase)
+{
+    // Ignore sync request if already in hardsync
+    if (this->hardsync_phase) {
+        SQUINE_COUNT(sync_ignored, 1);
+        return;
+    }
+
+    // If waveform is on last flat part, we're just done now
+    // (could also start a full spike here, it's an option...)
+    if (sweep_phase == 2.0) {
+        this->phase = 2.0;
+        return;
+    }
+
+    if (freq > this->Max_Sync_Freq) {
+        SQUINE_COUNT(sync_ignored, 1);
+        return;
+    }
+
+    SQUINE_COUNT(sync_triggers, 1);
+    this->hardsync_inc = this->Sync_Phase_Inc;
+    this->hardsync_phase = this->hardsync_inc * 0.5;
+}
+
+/* ================================================================== */
+
+/* One sample of the state machine at position i, for process() and process_sample().
+ * sync_now starts a hardsync sweep. Returns true at the wraparound that ends one.
+ */
+template <typename Real>
+template <int Flags, int Sign>
+SQUINE_ALWAYS_INLINE bool oscillator<Real>::next_sample(float* const sound_out, float* const sync_out, const int32_t i,
+                                                        const Real raw_freq, const Real clip, Real skew, const bool sync_now) {
+    // Just invert negative freqs (run "backwards" by mirroring the waveform)
+    Real freq = fabs(raw_freq);
+    bool hardsync_end = false;
+
+    // hardsync requested?
+    if (sync_now) {
+        hardsync_init(freq, sweep_phase);
+    }
+
+    // hardsync ongoing? Increase freq until wraparound
+    if (hardsync_phase) {
+        SQUINE_COUNT(hardsync, 1);
+        const Real syncsweep = Real(0.5) * (1 - cos_rad(hardsync_phase));
+        freq += syncsweep * (Max_Sync_Freq - freq);
+        hardsync_phase += hardsync_inc;
+        if (hardsync_phase > pi) {
+            hardsync_phase = pi;
+            hardsync_inc = 0;
+        }
+    }
+    // Through-Zero modulation: Detect zero-crossings and neg freq
+    if (Sign == Freq_Crossing) {
+        bool zero_crossing = (raw_freq < 0) != neg_freq;
+        if (zero_crossing) {
+            SQUINE_COUNT(zero_crossings, 1);
+            // Jump to opposite side of waveform
+            phase = 1.5 - phase;
+            if (phase < 0) phase += 2.0;
+            // mirror sweep_phase around 1 (cos rad)
+            sweep_phase = 2.0 - sweep_phase;
+        }
+        neg_freq = (raw_freq < 0);
+        if (neg_freq) {
+            // Invert symmetry for backward waveform
+            skew = Clamp<Real>(2 - skew, 0, 2);
+        }
+    }
+    else if (Sign == Freq_Negative) {
+        skew = Clamp<Real>(2 - skew, 0, 2);
+    }
+
+    const double phase_inc = Maxphase_By_sr * freq;
+
+    // Pure sine if freq > sr / (2 * Min_Sweep)
+    if (freq >= Max_Sweep_Freq) {
+        // Continue from sweep_phase
+        SQUINE_COUNT(pure_sine, 1);
+        sound_out[i] = static_cast<float>( cos_pi<Real>(sweep_phase) );
+        phase = sweep_phase;
+        sweep_phase += phase_inc;
+    }
+    else {
+        const Real min_sweep = phase_inc * Min_Sweep;
+        const Real midpoint = Clamp<Real>(skew, min_sweep, 2 - min_sweep);
+
+        // 1st half: Sweep down to cos(sweep_phase <= pi) then flat -1 until phase >= midpoint
+        if (sweep_phase < 1.0) {
+            const Real sweep_length = fmax(clip * midpoint, min_sweep);
+
+            SQUINE_COUNT(sweep, 1);
+            sound_out[i] = static_cast<float>( cos_pi<Real>(sweep_phase) );
+            sweep_phase += fmin(phase_inc / sweep_length, Max_Sweep_Inc);
+
+            // Handle fractional sweep_phase overshoot after sweep ends
+            if (sweep_phase > 1.0) {
+                /* Tricky here: phase and sweep_phase may disagree where we are in waveform (due to FM + skew/clip changes).
+                 * Sweep_phase dominates to keep waveform stable, waveform (flat part) decides where we are.
+                 */
+                const Real flat_length = midpoint - sweep_length;
+                // sweep_phase overshoot scaled to main phase rate
+                const double phase_overshoot = (sweep_phase - 1.0) * sweep_length;
+
+                // phase matches shape
+                phase = midpoint - flat_length + phase_overshoot - phase_inc;
+
+                // Flat if next samp still not at midpoint
+                if (flat_length >= phase_overshoot) {
+                    sweep_phase = 1.0;
+                    // phase may be > midpoint here (which means actually no flat part),
+                    // if so it will be corrected in 2nd half (since sweep_phase == 1.0)
+                }
+                else {
+                    const Real next_sweep_length = fmax(clip * (2 - midpoint), min_sweep);
+                    sweep_phase = 1.0 + (phase_overshoot - flat_length) / next_sweep_length;
+                }
+            }
+        }
+        // flat up to midpoint
+        else if (sweep_phase == 1.0 && phase < midpoint) {
+            SQUINE_COUNT(flat, 1);
+            sound_out[i] = -1.0;
+        }
+        // 2nd half: Sweep up to cos(sweep_phase <= 2.pi) then flat +1 until phase >= 2
+        else if (sweep_phase < 2.0) {
+            const Real sweep_length = fmax(clip * (2 - midpoint), min_sweep);
+            if (sweep_phase == 1.0) {
+                // sweep_phase overshoot after flat part
+                sweep_phase = 1.0 + fmin( fmin(phase - midpoint, phase_inc) / sweep_length, Max_Sweep_Inc);
+            }
+            SQUINE_COUNT(sweep, 1);
+            sound_out[i] = static_cast<float>( cos_pi<Real>(sweep_phase) );
+            sweep_phase += fmin(phase_inc / sweep_length, Max_Sweep_Inc);
+
+            if (sweep_phase > 2.0) {
+                const Real flat_length = 2 - (midpoint + sweep_length);
+                const double phase_overshoot = (sweep_phase - 2.0) * sweep_length;
+
+                phase = 2.0 - flat_length + phase_overshoot - phase_inc;
+
+                if (flat_length >= phase_overshoot) {
+                    sweep_phase = 2.0;
+                }
+                else {
+                    const Real next_sweep_length = fmax(clip * midpoint, min_sweep);
+                    sweep_phase = 2.0 + (phase_overshoot - flat_length) / next_sweep_length;
+                }
+            }
+        }
+        // flat until endpoint
+        else {
+            SQUINE_COUNT(flat, 1);
+            sound_out[i] = 1.0;
+            sweep_phase = 2.0;
+        }
+    }
+
+    phase += phase_inc;
+
+    // Phase wraparound
+    if (sweep_phase >= 2.0 && phase >= 2.0)
+    {
+        SQUINE_COUNT(wraparounds, 1);
+        if (hardsync_phase) {
+            sweep_phase = phase = 0.0;
+            hardsync_phase = hardsync_inc = 0;
+            hardsync_end = true;
+        }
+        else {
+            phase -= 2.0;
+            if (phase > phase_inc) {
+                // wild aliasing freq - just reset
+                SQUINE_COUNT(alias_resets, 1);
+                phase = phase_inc * 0.5;
+            }
+            if (freq < Max_Sweep_Freq) {
+                const Real min_sweep = phase_inc * Min_Sweep;
+                const Real midpoint = Clamp<Real>(skew, min_sweep, 2 - min_sweep);
+                const Real next_sweep_length = fmax(clip * midpoint, min_sweep);
+                sweep_phase = fmin(phase / next_sweep_length, Max_Sweep_Inc);
+            }
+            else
+                sweep_phase = phase;
+        }
+
+        if (Flags & Sync_Out)
+            sync_out[i] = 1.0;
+    }
+    return hardsync_end;
+}
+
+template <typename Real>
+template <int Flags>
+void oscillator<Real>::process(float* const sound_out, float* const sync_out, const int32_t nSamples,
+                                 const float* freq_sig, const float* clip_sig, const float* skew_sig, const float* sync_sig) {
+    constexpr bool freq_ar = (Flags & Freq_AR) != 0;
+    constexpr bool clip_ar = (Flags & Clip_AR) != 0;
+    constexpr bool skew_ar = (Flags & Skew_AR) != 0;
+    constexpr bool sync_ar = (Flags & Sync_AR) != 0;
+    constexpr bool sync_out_on = (Flags & Sync_Out) != 0;
+
+    SQUINE_COUNT(blocks, 1);
+
+    // Get next input buffer (or kr value)
+    freq_param.reinit(freq_sig, nSamples);
+    clip_param.reinit(clip_sig, nSamples);
+    skew_param.reinit(skew_sig, nSamples);
+
+    if (Adapt_Max)
+        adapt_min_sweep<freq_ar>(freq_sig, nSamples);
+
+    /* Audio-rate inputs count as static in blocks of one value. They are only scanned in blocks long enough
+     * for run-length mode to pay, and only while all inputs before them held: a constant a-rate clip or skew
+     * is not used on its own (moving blocks below keep the plain a-rate loop).
+     */
+    const bool scan_ar = fast_paths && nSamples >= Min_Constant_Block;
+    const bool freq_static = freq_ar ? scan_ar && freq_param.is_constant(nSamples) : freq_param.is_static();
+    const bool clip_static = clip_ar ? scan_ar && freq_static && clip_param.is_constant(nSamples) : clip_param.is_static();
+    const bool skew_static = skew_ar ? scan_ar && freq_static && clip_static && skew_param.is_constant(nSamples)
+                                     : skew_param.is_static();
+
+    // Clamp values once if static this block
+    const Real static_clip = clip_static ? get_clip<Real>(clip_param.get_current()) : 0;
+    const Real static_skew = skew_static ? get_skew<Real>(skew_param.get_current()) : 0;
+
+    // Static freq/clip/skew this block: run-length mode between segment ends
+    const bool static_shape = fast_paths && freq_static && clip_static && skew_static
+                              && neg_freq == (freq_param.get_current() < 0);
+    const segment_geometry& geometry = static_shape ? get_geometry(freq_param.get_current(), static_clip, static_skew)
+                                                    : this->geometry;
+
+    // Look for sync if a-rate
+    sync_triggers triggers(sync_sig, nSamples);
+    int32_t sync = sync_ar ? triggers.find(0) : -1;
+
+    // Sync output is a trigger at each wraparound
+    if (sync_out_on) {
+        memset(sync_out, 0, nSamples * sizeof(float));
+    }
+
+    // Through-zero FM: zero-crossing checks and mirroring only run in blocks that cross zero
+    const int freq_sign = get_freq_sign<freq_ar>(freq_sig, nSamples);
+
+    /* Sample loop, specialized on freq_sign. Moving: audio-rate inputs are not constant this block,
+     * so the run-length and static clip/skew checks compile out of the per-sample path.
+     */
+    auto run = [&](auto sign_tag, auto moving_tag) {
+        constexpr int Sign = decltype(sign_tag)::value;
+        constexpr bool Moving = decltype(moving_tag)::value;
+        for (int32_t i = 0; i < nSamples; ++i) {
+            if (!Moving && static_shape && !hardsync_phase) {
+                i = run_segment(sound_out, i, (sync >= i) ? sync : nSamples, geometry);
+                if (i == nSamples)
+                    break;
+            }
+
+            const Real raw_freq = freq_param.template get_next<freq_ar>(i);
+            const Real clip = (!(Moving && clip_ar) && clip_static) ? static_clip : get_clip<Real>(clip_param.template get_next<clip_ar>(i));
+            const Real skew = (!(Moving && skew_ar) && skew_static) ? static_skew : get_skew<Real>(skew_param.template get_next<skew_ar>(i));
+
+            if (next_sample<Flags, Sign>(sound_out, sync_out, i, raw_freq, clip, skew, i == sync))
+                sync = sync_ar ? triggers.find(i) : -1;
+        }
+    };
+    auto run_sign = [&](auto moving_tag) {
+        if (freq_sign == Freq_Positive)
+            run(std::integral_constant<int, Freq_Positive>(), moving_tag);
+        else if (freq_sign == Freq_Negative)
+            run(std::integral_constant<int, Freq_Negative>(), moving_tag);
+        else
+            run(std::integral_constant<int, Freq_Crossing>(), moving_tag);
+    };
+    if ((freq_ar || clip_ar || skew_ar) && !static_shape)
+        run_sign(std::true_type());
+    else
+        run_sign(std::false_type());
+}
+
+template <typename Real>
+template <int Flags>
+void oscillator<Real>::process_sample(float* const sound_out, float* const sync_out,
+                                        const float* freq_sig, const float* clip_sig, const float* skew_sig, const float* sync_sig) {
+    SQUINE_COUNT(blocks, 1);
+
+    const Real raw_freq = freq_param.template get_single<(Flags & Freq_AR) != 0>(freq_sig);
+    const Real clip = get_clip<Real>(clip_param.template get_single<(Flags & Clip_AR) != 0>(clip_sig));
+    const Real skew = get_skew<Real>(skew_param.template get_single<(Flags & Skew_AR) != 0>(skew_sig));
+    const bool sync_now = (Flags & Sync_AR) && sync_sig[0] >= 1.0f;
+
+    if (Adapt_Max)
+        adapt_min_sweep<(Flags & Freq_AR) != 0>(freq_sig, 1);
+
+    if (Flags & Sync_Out)
+        sync_out[0] = 0;
+    // Per-sample sign check: as process() in a block that crosses zero
+    next_sample<Flags, Freq_Crossing>(sound_out, sync_out, 0, raw_freq, clip, skew, sync_now);
+}
+
+template <typename Real>
+void oscillator<Real>::render(const int flags, float* sound_out, float* sync_out, const int64_t numSamples,
+                                const float* freq_sig, const float* clip_sig, const float* skew_sig, const float* sync_sig) {
+    typedef std::make_integer_sequence<int, Num_Process_Variants> variants;
+    for (int64_t done = 0; done < numSamples; ) {
+        const int32_t count = static_cast<int32_t>((numSamples - done < Render_Chunk) ? numSamples - done : int64_t(Render_Chunk));
+        render_variant(flags, sound_out + done, sync_out ? sync_out + done : nullptr, count,
+                       (flags & Freq_AR) ? freq_sig + done : freq_sig,
+                       (flags & Clip_AR) ? clip_sig + done : clip_sig,
+                       (flags & Skew_AR) ? skew_sig + done : skew_sig,
+                       (flags & Sync_AR) ? sync_sig + done : sync_sig, variants());
+        done += count;
+    }
+}
+
+template <typename Real>
+template <int... Flags>
+void oscillator<Real>::render_variant(const int flags, float* sound_out, float* sync_out, const int32_t nSamples,
+                                        const float* freq_sig, const float* clip_sig, const float* skew_sig, const float* sync_sig,
+                                        std::integer_sequence<int, Flags...>) {
+    typedef void (oscillator::*process_fn)(float* const, float* const, const int32_t,
+                                           const float*, const float*, const float*, const float*);
+    const process_fn variants[] = { &oscillator::template process<Flags>... };
+    (this->*variants[flags])(sound_out, sync_out, nSamples, freq_sig, clip_sig, skew_sig, sync_sig);
+}
+
+/* ================================================================== */
+
+// Half-band taps (Kaiser window), pair coefficients for offsets 1, 3, 5... from the 0.5 center tap
+// 71 taps: pass 0-0.208, stop 0.292-0.5 of input rate at -90 dB (at 2x 48 kHz: flat to 20 kHz, no aliases below 20 kHz)
+alignas(64) constexpr float Halfband_2x[18] = {
+    0.317214233f, -0.102856983f, 0.0583819202f, -0.0383448028f, 0.0266332907f, -0.0188773553f,
+    0.0134024029f, -0.00942013742f, 0.0064979524f, -0.00436567223f, 0.00283522751f, -0.00176462f,
+    0.00104116266f, -0.000573576113f, 0.000288138601f, -0.000126527705f, 4.41804795e-05f, -8.6357839e-06f
+};
+// 31 taps: pass 0-0.104, stop 0.354-0.5 at -90 dB, first stage of 4x (leaves 2x band edge to Halfband_2x)
+alignas(64) constexpr float Halfband_4x[8] = {
+    0.312354139f, -0.0893975689f, 0.0392229736f, -0.0171241361f,
+    0.00656258927f, -0.00198297672f, 0.00038796306f, -1.94043354e-05f
+};
+
+/* Half-band FIR decimator by 2, polyphase form.
+ * Input is split into even and odd samples: the odd phase only has the 0.5 center tap,
+ * the even phase has the symmetric pairs. Each tap is one loop over the chunk, which vectorizes.
+ */
+template <int Pairs>
+class halfband_decimator
+{
+    enum { Chunk_Size = 64 };
+
+    const float* coefs;
+    float even[2 * Pairs + Chunk_Size] = {};  // history of 2 * Pairs even samples, then current chunk
+    float odd[Pairs + Chunk_Size] = {};       // history of Pairs odd samples, then current chunk
+
+public:
+    explicit halfband_decimator(const float* coefs) : coefs(coefs) {}
+
+    // Latency in output samples
+    static constexpr double delay() { return Pairs - 0.5; }
+
+    // Reads 2 * n samples, writes n. Output may be same buffer as input.
+    void process(const float* in, float* out, int32_t n)
+    {
+        while (n > 0) {
+            const int32_t count = (n < Chunk_Size) ? n : Chunk_Size;
+            for (int32_t i = 0; i < count; ++i) {
+                even[2 * Pairs + i] = in[2 * i];
+                odd[Pairs + i] = in[2 * i + 1];
+            }
+            for (int32_t i = 0; i < count; ++i) {
+                out[i] = 0.5f * odd[i];
+            }
+            for (int32_t j = 0; j < Pairs; ++j) {
+                const float c = coefs[j];
+                const float* const before = even + Pairs - j;
+                const float* const after = even + Pairs + j + 1;
+                for (int32_t i = 0; i < count; ++i) {
+                    out[i] += c * (before[i] + after[i]);
+                }
+            }
+            memmove(even, even + count, 2 * Pairs * sizeof(float));
+            memmove(odd, odd + count, Pairs * sizeof(float));
+            in += 2 * count;
+            out += count;
+            n -= count;
+        }
+    }
+};
+
+/* ================================================================== */
+
+/* Runs an oscillator at 2x or 4x the host rate, then decimates to host rate.
+ * The oscillator must be inited with the oversampled rate, so Min_Sweep and Max_Sweep_Freq scale up:
+ * square/pulse shapes hold to factor times higher freq before they degrade to sine.
+ * Audio-rate inputs are linearly interpolated, sync triggers go to first oversampled sample.
+ * Sound is delayed by delay() samples by the filters, sync output is not.
+ */
+class oversampler
+{
+    const int factor;
+    float last_freq = 0;
+    float last_clip = 0;
+    float last_skew = 0;
+    halfband_decimator<8> stage_4x { Halfband_4x };
+    halfband_decimator<18> stage_2x { Halfband_2x };
+
+    void upsample(const float* in, float* out, int32_t n, float& last) const;
+
+public:
+    // factor 2 or 4
+    explicit oversampler(const int factor) : factor(factor) {}
+
+    // First values of audio-rate inputs, start of interpolation
+    void init_inputs(const float freq, const float clip, const float skew) {
+        last_freq = freq;
+        last_clip = clip;
+        last_skew = skew;
+    }
+
+    // Scratch memory size in floats, for blocks up to max_block samples
+    static int32_t scratch_size(const int factor, const int32_t max_block) { return 7 * factor * max_block; }
+
+    // Latency of sound output in host-rate samples
+    double delay() const {
+        return (factor == 4) ? stage_2x.delay() + 0.5 * stage_4x.delay() : stage_2x.delay();
+    }
+
+    // Oscillator process() at oversampled rate, same arguments plus scratch (see scratch_size)
+    template <int Flags, typename Real>
+    void process(oscillator<Real>& osc, float* scratch, float* const sound_out, float* const sync_out, const int32_t nSamples,
+                 const float* freq_sig, const float* clip_sig, const float* skew_sig, const float* sync_sig);
+};
+
+inline void oversampler::upsample(const float* in, float* out, int32_t n, float& last) const
+{
+    const float step = 1.0f / factor;
+    for (int32_t i = 0; i < n; ++i) {
+        const float delta = in[i] - last;
+        for (int k = 0; k < factor; ++k) {
+            out[i * factor + k] = last + delta * (step * (k + 1));
+        }
+        last = in[i];
+    }
+}
+
+template <int Flags, typename Real>
+void oversampler::process(oscillator<Real>& osc, float* scratch, float* const sound_out, float* const sync_out, const int32_t nSamples,
+                          const float* freq_sig, const float* clip_sig, const float* skew_sig, const float* sync_sig)
+{
+    typedef oscillator<Real> osc_type;
+    const int32_t os_samples = factor * nSamples;
+    float* const os_sound = scratch;
+    float* const os_sync_out = os_sound + os_samples;
+    float* const os_freq = os_sync_out + os_samples;
+    float* const os_clip = os_freq + os_samples;
+    float* const os_skew = os_clip + os_samples;
+    float* const os_sync = os_skew + os_samples;
+    float* const half_rate = os_sync + os_samples;
+
+    // Control-rate inputs are ramped by the oscillator over the oversampled block
+    if (Flags & osc_type::Freq_AR) {
+        upsample(freq_sig, os_freq, nSamples, last_freq);
+        freq_sig = os_freq;
+    }
+    if (Flags & osc_type::Clip_AR) {
+        upsample(clip_sig, os_clip, nSamples, last_clip);
+        clip_sig = os_clip;
+    }
+    if (Flags & osc_type::Skew_AR) {
+        upsample(skew_sig, os_skew, nSamples, last_skew);
+        skew_sig = os_skew;
+    }
+    if (Flags & osc_type::Sync_AR) {
+        memset(os_sync, 0, os_samples * sizeof(float));
+        for (int32_t i = 0; i < nSamples; ++i) {
+            os_sync[i * factor] = sync_sig[i];
+        }
+        sync_sig = os_sync;
+    }
+
+    osc.template process<Flags>(os_sound, os_sync_out, os_samples, freq_sig, clip_sig, skew_sig, sync_sig);
+
+    if (factor == 4) {
+        stage_4x.process(os_sound, half_rate, 2 * nSamples);
+        stage_2x.process(half_rate, sound_out, nSamples);
+    }
+    else {
+        stage_2x.process(os_sound, sound_out, nSamples);
+    }
+
+    // Trigger if any wraparound within the oversampled samples
+    if (Flags & osc_type::Sync_Out) {
+        for (int32_t i = 0; i < nSamples; ++i) {
+            float trigger = 0;
+            for (int k = 0; k < factor; ++k) {
+                trigger = (os_sync_out[i * factor + k] > trigger) ? os_sync_out[i * factor + k] : trigger;
+            }
+            sync_out[i] = trigger;
+        }
+    }
+}
+
+#undef SQUINE_COUNT
+#undef SQUINE_ALWAYS_INLINE
+
+#ifdef SQUINE_ISA
+} // namespace SQUINE_ISA
+#endif
+} // namespace squinewave
+
+#endif // SQUINEWAVE_HPP
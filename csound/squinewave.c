@@ -1,6 +1,8 @@
 /* SQUINEWAVE.C: Sine-Square-Pulse-Saw oscillator
 * by rasmus ekman 2017, for Csound.
 *
+* Update 2026:
+* - k-rate freq, clip and skew, with a perf loop specialized per input rate
 * Update 2023:
 * - Through-Zero FM: Run "backwards" on neg freq
 * Update 2021:
@@ -40,8 +42,21 @@ typedef struct {
 
     MYFLT *sync_sig;        // holds async_in if a-rate
     int32_t init_phase;
+    int32_t rates;          // SQUINE_*_AR flags of freq, clip and skew
 } SQUINEWAVE;
 
+// Audio-rate inputs, selects the specialized perf loop
+#define SQUINE_FREQ_AR 1
+#define SQUINE_CLIP_AR 2
+#define SQUINE_SKEW_AR 4
+
+// The perf loop is inlined once per input rate combination, where rate tests are constant
+#if defined(__GNUC__)
+#define SQUINE_INLINE static inline __attribute__((always_inline))
+#else
+#define SQUINE_INLINE static inline
+#endif
+
 /* ================================================================== */
 
 static inline int32_t find_sync(const MYFLT* sync_sig, const uint32_t first,
@@ -117,6 +132,9 @@ int32_t squinewave_init(CSOUND* csound, SQUINEWAVE *p)
     p->Sync_Phase_Inc = 1.0 / log(p->Min_Sweep);
 
     p->sync_sig = IS_ASIG_ARG(p->async_in) ? p->async_in : 0;
+    p->rates = (IS_ASIG_ARG(p->acps) ? SQUINE_FREQ_AR : 0)
+             | (IS_ASIG_ARG(p->aclip) ? SQUINE_CLIP_AR : 0)
+             | (IS_ASIG_ARG(p->askew) ? SQUINE_SKEW_AR : 0);
 
     return OK;
 }
@@ -124,20 +142,15 @@ int32_t squinewave_init(CSOUND* csound, SQUINEWAVE *p)
 
 /* ================================================================== */
 
-int32_t squinewave_gen(CSOUND* csound, SQUINEWAVE *p)
+/* Perf loop over samples first to last, rates are SQUINE_*_AR flags.
+ * k-rate inputs hold one value per cycle: their clamps move out of the loop,
+ * with the same results as an a-rate input of that value.
+ */
+SQUINE_INLINE void squinewave_run(SQUINEWAVE *p, const uint32_t first,
+                                  const uint32_t last, const int32_t rates)
 {
-    IGN(csound);
-    const uint32_t nsmps = CS_KSMPS;
     uint32_t n;
 
-    // Clear parts of output outside event
-    const uint32_t ksmps_offset = p->h.insdshead->ksmps_offset;
-    const uint32_t ksmps_end = nsmps - p->h.insdshead->ksmps_no_end;
-    if (UNLIKELY(ksmps_offset)) memset(p->aout, 0, ksmps_offset * sizeof(MYFLT));
-    if (UNLIKELY(ksmps_end < nsmps)) {
-      memset(&p->aout[ksmps_end], 0, p->h.insdshead->ksmps_no_end * sizeof(MYFLT));
-    }
-
     const double Min_Sweep = p->Min_Sweep;
     const double Maxphase_By_sr = p->Maxphase_By_sr;
     const double Max_Sweep_Freq = p->Max_Sweep_Freq;
@@ -149,69 +162,23 @@ int32_t squinewave_gen(CSOUND* csound, SQUINEWAVE *p)
     const MYFLT * const clip_sig = p->aclip;
     const MYFLT * const skew_sig = p->askew;
 
+    // k-rate values, clamped once per cycle (skew also mirrored, for neg freq)
+    const double freq_k = freq_sig[0];
+    const double clip_k = 1.0 - Clamp(clip_sig[0], 0.0, 1.0);
+    const double skew_k = 1.0 - Clamp(skew_sig[0], -1.0, 1.0);
+    const double skew_k_neg = 1.0 - Clamp(-skew_sig[0], -1.0, 1.0);
+
     double phase = p->phase;
     double sweep_phase = p->sweep_phase;
     int32_t neg_freq = p->neg_freq;
 
     double hardsync_phase = p->hardsync_phase;
     double hardsync_inc = p->hardsync_inc;
-    int32_t sync = find_sync(p->sync_sig, ksmps_offset, ksmps_end);
+    int32_t sync = find_sync(p->sync_sig, first, last);
 
-    // Set main phase so it matches sweep_phase
-    if (p->init_phase) {
-      const double freq = fabs(freq_sig[0]);
-      const double phase_inc = freq * Maxphase_By_sr;
-      const double min_sweep = phase_inc * Min_Sweep;
-      const double skew = 1.0 - Clamp(skew_sig[0], -1.0, 1.0);
-      const double clip = 1.0 - Clamp(clip_sig[0], 0.0, 1.0);
-      const double midpoint = Clamp(skew, min_sweep, 2.0 - min_sweep);
-
-      // Init phase range 0-2, has 4 segment parts (sweep down,
-      // flat -1, sweep up, flat +1)
-      sweep_phase = *p->iphase;
-      if (sweep_phase < 0.0) {
-        // "up" 0-crossing
-        sweep_phase = 1.25;
-      }
-      if (sweep_phase > 2.0)
-        sweep_phase = fmod(sweep_phase, 2.0);
-
-      // Select segment and scale within
-      if (sweep_phase < 1.0) {
-        const double sweep_length = fmax(clip * midpoint, min_sweep);
-        if (sweep_phase < 0.5) {
-          phase = sweep_length * (sweep_phase * 2.0);
-          sweep_phase *= 2.0;
-        }
-        else {
-          const double flat_length = midpoint - sweep_length;
-          phase = sweep_length + flat_length * ((sweep_phase - 0.5) * 2.0);
-          sweep_phase = 1.0;
-        }
-      }
-      else {
-        const double sweep_length = fmax(clip * (2.0 - midpoint), min_sweep);
-        if (sweep_phase < 1.5) {
-          phase = midpoint + sweep_length * ((sweep_phase - 1.0) * 2.0);
-          sweep_phase = 1.0 + (sweep_phase - 1.0) * 2.0;
-        }
-        else {
-          const double flat_length = 2.0 - (midpoint + sweep_length);
-          phase = midpoint + sweep_length + flat_length * ((sweep_phase - 1.5) * 2.0);
-          sweep_phase = 2.0;
-        }
-      }
-
-      p->init_phase = 0;
-    }
-
-    if (p->async_out)
-      memset(p->async_out, 0, nsmps * sizeof(MYFLT));
-
-
-    for (n = ksmps_offset; n < ksmps_end; ++n)
+    for (n = first; n < last; ++n)
     {
-      const double raw_freq = freq_sig[n];
+      const double raw_freq = (rates & SQUINE_FREQ_AR) ? freq_sig[n] : freq_k;
       double freq = fabs(raw_freq);
 
       if (sync == (int32_t)n) {
@@ -260,9 +227,10 @@ int32_t squinewave_gen(CSOUND* csound, SQUINEWAVE *p)
       else
       {
         const double min_sweep = phase_inc * Min_Sweep;
-        const double clip = 1.0 - Clamp(clip_sig[n], 0.0, 1.0);
+        const double clip = (rates & SQUINE_CLIP_AR) ? 1.0 - Clamp(clip_sig[n], 0.0, 1.0) : clip_k;
         // If neg_freq, invert symmetry for backward waveform
-        const double skew = 1.0 - Clamp( (neg_freq)? -skew_sig[n] : skew_sig[n], -1.0, 1.0);
+        const double skew = (rates & SQUINE_SKEW_AR) ? 1.0 - Clamp( (neg_freq)? -skew_sig[n] : skew_sig[n], -1.0, 1.0)
+                                                     : (neg_freq)? skew_k_neg : skew_k;
         const double midpoint = Clamp(skew, min_sweep, 2.0 - min_sweep);
 
         // 1st half: Sweep down to cos(sweep_phase <= Pi) then
@@ -346,7 +314,7 @@ int32_t squinewave_gen(CSOUND* csound, SQUINEWAVE *p)
               sweep_phase = phase = 0.0;
               hardsync_phase = hardsync_inc = 0.0;
 
-              sync = find_sync(p->sync_sig, n + 1, ksmps_end);
+              sync = find_sync(p->sync_sig, n + 1, last);
             }
             else {
               phase -= 2.0;
@@ -356,8 +324,9 @@ int32_t squinewave_gen(CSOUND* csound, SQUINEWAVE *p)
               }
               if (freq < Max_Sweep_Freq) {
                 const double min_sweep = phase_inc * Min_Sweep;
-                const double clip = 1.0 - Clamp(clip_sig[n], 0.0, 1.0);
-                const double skew = 1.0 - Clamp( (neg_freq)? -skew_sig[n] : skew_sig[n], -1.0, 1.0);
+                const double clip = (rates & SQUINE_CLIP_AR) ? 1.0 - Clamp(clip_sig[n], 0.0, 1.0) : clip_k;
+                const double skew = (rates & SQUINE_SKEW_AR) ? 1.0 - Clamp( (neg_freq)? -skew_sig[n] : skew_sig[n], -1.0, 1.0)
+                                                             : (neg_freq)? skew_k_neg : skew_k;
                 const double midpoint = Clamp(skew, min_sweep, 2.0 - min_sweep);
                 const double next_sweep_length = fmax(clip * midpoint, min_sweep);
                 sweep_phase = fmin(phase / next_sweep_length, Max_Sweep_Inc);
@@ -376,21 +345,114 @@ int32_t squinewave_gen(CSOUND* csound, SQUINEWAVE *p)
     p->hardsync_phase = hardsync_phase;
     p->hardsync_inc = hardsync_inc;
     p->neg_freq = neg_freq;
-    return OK;
 }
 
 
+/* ================================================================== */
+
+int32_t squinewave_gen(CSOUND* csound, SQUINEWAVE *p)
+{
+    IGN(csound);
+    const uint32_t nsmps = CS_KSMPS;
+
+    // Clear parts of output outside event
+    const uint32_t ksmps_offset = p->h.insdshead->ksmps_offset;
+    const uint32_t ksmps_end = nsmps - p->h.insdshead->ksmps_no_end;
+    if (UNLIKELY(ksmps_offset)) memset(p->aout, 0, ksmps_offset * sizeof(MYFLT));
+    if (UNLIKELY(ksmps_end < nsmps)) {
+      memset(&p->aout[ksmps_end], 0, p->h.insdshead->ksmps_no_end * sizeof(MYFLT));
+    }
+
+    // Set main phase so it matches sweep_phase
+    if (p->init_phase) {
+      double phase, sweep_phase;
+      const double freq = fabs(p->acps[0]);
+      const double phase_inc = freq * p->Maxphase_By_sr;
+      const double min_sweep = phase_inc * p->Min_Sweep;
+      const double skew = 1.0 - Clamp(p->askew[0], -1.0, 1.0);
+      const double clip = 1.0 - Clamp(p->aclip[0], 0.0, 1.0);
+      const double midpoint = Clamp(skew, min_sweep, 2.0 - min_sweep);
+
+      // Init phase range 0-2, has 4 segment parts (sweep down,
+      // flat -1, sweep up, flat +1)
+      sweep_phase = *p->iphase;
+      if (sweep_phase < 0.0) {
+        // "up" 0-crossing
+        sweep_phase = 1.25;
+      }
+      if (sweep_phase > 2.0)
+        sweep_phase = fmod(sweep_phase, 2.0);
+
+      // Select segment and scale within
+      if (sweep_phase < 1.0) {
+        const double sweep_length = fmax(clip * midpoint, min_sweep);
+        if (sweep_phase < 0.5) {
+          phase = sweep_length * (sweep_phase * 2.0);
+          sweep_phase *= 2.0;
+        }
+        else {
+          const double flat_length = midpoint - sweep_length;
+          phase = sweep_length + flat_length * ((sweep_phase - 0.5) * 2.0);
+          sweep_phase = 1.0;
+        }
+      }
+      else {
+        const double sweep_length = fmax(clip * (2.0 - midpoint), min_sweep);
+        if (sweep_phase < 1.5) {
+          phase = midpoint + sweep_length * ((sweep_phase - 1.0) * 2.0);
+          sweep_phase = 1.0 + (sweep_phase - 1.0) * 2.0;
+        }
+        else {
+          const double flat_length = 2.0 - (midpoint + sweep_length);
+          phase = midpoint + sweep_length + flat_length * ((sweep_phase - 1.5) * 2.0);
+          sweep_phase = 2.0;
+        }
+      }
+
+      p->phase = phase;
+      p->sweep_phase = sweep_phase;
+      p->init_phase = 0;
+    }
+
+    if (p->async_out)
+      memset(p->async_out, 0, nsmps * sizeof(MYFLT));
+
+    // One specialized loop per rate combination
+    switch (p->rates) {
+    case 0:
+      squinewave_run(p, ksmps_offset, ksmps_end, 0); break;
+    case SQUINE_FREQ_AR:
+      squinewave_run(p, ksmps_offset, ksmps_end, SQUINE_FREQ_AR); break;
+    case SQUINE_CLIP_AR:
+      squinewave_run(p, ksmps_offset, ksmps_end, SQUINE_CLIP_AR); break;
+    case SQUINE_FREQ_AR | SQUINE_CLIP_AR:
+      squinewave_run(p, ksmps_offset, ksmps_end, SQUINE_FREQ_AR | SQUINE_CLIP_AR); break;
+    case SQUINE_SKEW_AR:
+      squinewave_run(p, ksmps_offset, ksmps_end, SQUINE_SKEW_AR); break;
+    case SQUINE_FREQ_AR | SQUINE_SKEW_AR:
+      squinewave_run(p, ksmps_offset, ksmps_end, SQUINE_FREQ_AR | SQUINE_SKEW_AR); break;
+    case SQUINE_CLIP_AR | SQUINE_SKEW_AR:
+      squinewave_run(p, ksmps_offset, ksmps_end, SQUINE_CLIP_AR | SQUINE_SKEW_AR); break;
+    default:
+      squinewave_run(p, ksmps_offset, ksmps_end,
+                     SQUINE_FREQ_AR | SQUINE_CLIP_AR | SQUINE_SKEW_AR); break;
+    }
+    return OK;
+}
+
 
 /* ================================================================== */
 
 
-/* ar[, aSyncOut] squinewave   aFreq, aClip, aSkew [, aSyncIn, aMinSweep, iphase] */
+/* ar[, aSyncOut] squinewave   xFreq, xClip, xSkew [, aSyncIn, iMinSweep, iphase]
+ * freq, clip and skew each a- or k-rate
+ */
 
 static OENTRY squinewave_localops[] =
   {
-   { "squinewave", sizeof(SQUINEWAVE), 0,  "am", "aaaaoj",
+   { "squinewave", sizeof(SQUINEWAVE), 0,  "am", "xxxaoj",
      (SUBR)squinewave_init, (SUBR)squinewave_gen },
-   { "squinewave", sizeof(SQUINEWAVE), 0,  "am", "aaaOoj",
+   { "squinewave", sizeof(SQUINEWAVE), 0,  "am", "xxxOoj",
      (SUBR)squinewave_init, (SUBR)squinewave_gen },
 };
 
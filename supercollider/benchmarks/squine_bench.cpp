@@ -0,0 +1,683 @@
+// Microbenchmarks for the Squinewave oscillator core
+// by rasmus ekman
+//
+// Runs squinewave::oscillator::process() (process_sample() at block size 1) over a matrix of input scenarios and block sizes,
+// in double (Squine) and float (SquineF) precision. Reports time per output sample.
+// With --scaling, instead runs many oscillators over 1 to --threads worker threads,
+// to check that throughput scales with threads like a supernova ParGroup should.
+//
+// With --write-outputs/--compare-outputs, instead renders each scenario once and saves it,
+// or compares it to the files saved by another build (eg squine_bench_fast_math, the FAST_MATH profile,
+// which sets FTZ/DAZ for the run as Squine does per calc).
+// Double scenarios must match within --tolerance (default 1e-6). Float scenarios may differ
+// up to --float-factor (default 4) times the saved float vs double difference: rounding changes
+// integrate into phase differences of the same order as SquineF's own deviation from Squine.
+//
+// With --verify, instead checks the optimized kernels (static fast paths at control and audio rate, float,
+// process_sample() at block size 1) against the reference, the double per-sample state machine with fast paths off: max abs error,
+// energy above Nyquist/2, and wraparound drift over 1e8 samples. Exits with 1 if any check fails.
+//
+// Usage: squine_bench [--filter substring] [--min-time seconds]
+//        squine_bench --scaling voices [--threads max] [--min-time seconds]
+//        squine_bench [--filter substring] --write-outputs dir
+//        squine_bench [--filter substring] --compare-outputs dir [--tolerance max_abs_diff] [--float-factor n]
+//        squine_bench [--filter substring] --verify
+
+#include "squinewave.hpp"
+#include "squine_scenarios.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define SQUINE_BENCH_TSC 1
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define SQUINE_BENCH_TSC 1
+#endif
+
+namespace {
+
+using namespace squine_scenarios;
+
+uint64_t read_tsc() {
+#ifdef SQUINE_BENCH_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/* ================================================================== */
+
+// Input buffers of one scenario. Control-rate inputs hold one value per block.
+struct input_signals
+{
+    std::vector<float> freq, clip, skew, sync;
+
+    input_signals(const scenario& s, int block_size) {
+        typedef squinewave::oscillator<double> rates;
+        fill(freq, s.freq, (s.flags & rates::Freq_AR) != 0, block_size);
+        fill(clip, s.clip, (s.flags & rates::Clip_AR) != 0, block_size);
+        fill(skew, s.skew, (s.flags & rates::Skew_AR) != 0, block_size);
+        fill(sync, s.sync ? s.sync : constant(0), (s.flags & rates::Sync_AR) != 0, block_size);
+    }
+
+    static void fill(std::vector<float>& buffer, const signal_fn& f, bool audio_rate, int block_size) {
+        const int num_blocks = Signal_Length / block_size;
+        buffer.resize(audio_rate ? num_blocks * block_size : num_blocks);
+        for (int i = 0; i < int(buffer.size()); ++i)
+            buffer[i] = f(audio_rate ? i : i * block_size);
+    }
+};
+
+struct result
+{
+    double ns_per_sample;
+    double cycles_per_sample;
+};
+
+/* Render signal length repeatedly for at least min_time seconds (after one warmup pass).
+ * Flags are the process() template argument, so each scenario runs its specialized loop.
+ * If rendered is set, only the warmup pass runs, and its output is stored there.
+ */
+template <typename Real, int Flags>
+result run(const scenario& s, const int block_size, const double min_time, std::vector<float>* rendered) {
+    typedef squinewave::oscillator<Real> oscillator;
+    const bool freq_ar = (Flags & oscillator::Freq_AR) != 0;
+    const bool clip_ar = (Flags & oscillator::Clip_AR) != 0;
+    const bool skew_ar = (Flags & oscillator::Skew_AR) != 0;
+    const bool sync_ar = (Flags & oscillator::Sync_AR) != 0;
+
+    const input_signals in(s, block_size);
+    const int num_blocks = Signal_Length / block_size;
+    std::vector<float> out(block_size);
+
+    oscillator osc;
+    osc.init(Sample_Rate, 8.0);
+    osc.init_inputs(Flags, in.freq.data(), in.clip.data(), in.skew.data(), false);
+    osc.init_phase(1.25, in.freq[0], in.clip[0], in.skew[0]);
+
+    // Last sample of each block is summed, so rendering can't be optimized away
+    float checksum = 0;
+    auto pass = [&] {
+        for (int b = 0; b < num_blocks; ++b) {
+            const int ar = b * block_size;
+            // Squine units at block size 1 run process_sample()
+            if (block_size == 1)
+                osc.template process_sample<Flags>(out.data(), nullptr, &in.freq[b], &in.clip[b], &in.skew[b], &in.sync[b]);
+            else
+                osc.template process<Flags>(out.data(), nullptr, block_size,
+                                            &in.freq[freq_ar ? ar : b], &in.clip[clip_ar ? ar : b],
+                                            &in.skew[skew_ar ? ar : b], &in.sync[sync_ar ? ar : b]);
+            checksum += out[block_size - 1];
+            if (rendered)
+                rendered->insert(rendered->end(), out.begin(), out.end());
+        }
+    };
+    pass();
+    if (rendered)
+        return { 0, 0 };
+
+    typedef std::chrono::steady_clock clock;
+    long samples = 0;
+    const clock::time_point start = clock::now();
+    const uint64_t start_tsc = read_tsc();
+    double elapsed = 0;
+    do {
+        pass();
+        samples += long(num_blocks) * block_size;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    } while (elapsed < min_time);
+    const uint64_t cycles = read_tsc() - start_tsc;
+
+    volatile float sink = checksum;
+    (void)sink;
+
+    return { elapsed * 1e9 / samples, double(cycles) / samples };
+}
+
+typedef result (*run_fn)(const scenario&, int, double, std::vector<float>*);
+
+template <typename Real, int... Flags>
+run_fn select_run(int flags, std::integer_sequence<int, Flags...>) {
+    const run_fn runs[] = { &run<Real, Flags>... };
+    return runs[flags];
+}
+
+/* ================================================================== */
+
+// One oscillator per cache line set, so threads never write to a shared line
+struct alignas(64) voice
+{
+    squinewave::oscillator<double> osc;
+    float out[64];
+};
+
+/* Render voices split over threads in 64-sample blocks, deep_fm inputs, for min_time seconds.
+ * Each thread owns its voices and input buffers, as units in separate ParGroup branches.
+ * Returns output samples per second, all threads together.
+ */
+double run_threads(const scenario& s, const int num_voices, const int num_threads, const double min_time) {
+    typedef squinewave::oscillator<double> oscillator;
+    const int Block_Size = 64;
+    const int Flags = oscillator::Freq_AR;
+    std::atomic<bool> go(false);
+    std::vector<long> samples(num_threads);
+    std::vector<double> elapsed(num_threads);
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t] {
+#ifdef SQUINE_FTZ
+            const squinewave::denormals_off ftz;
+#endif
+            const input_signals in(s, Block_Size);
+            const int num_blocks = Signal_Length / Block_Size;
+            std::vector<voice> voices(num_voices / num_threads + (t < num_voices % num_threads));
+            for (voice& v : voices) {
+                v.osc.init(Sample_Rate, 8.0);
+                v.osc.init_inputs(Flags, in.freq.data(), in.clip.data(), in.skew.data(), false);
+            }
+            while (!go)
+                std::this_thread::yield();
+
+            typedef std::chrono::steady_clock clock;
+            const clock::time_point start = clock::now();
+            long count = 0;
+            do {
+                for (int b = 0; b < num_blocks; ++b) {
+                    for (voice& v : voices)
+                        v.osc.template process<Flags>(v.out, nullptr, Block_Size, &in.freq[b * Block_Size],
+                                                      &in.clip[b], &in.skew[b], nullptr);
+                }
+                count += long(num_blocks) * Block_Size * voices.size();
+            } while (std::chrono::duration<double>(clock::now() - start).count() < min_time);
+            elapsed[t] = std::chrono::duration<double>(clock::now() - start).count();
+            samples[t] = count;
+        });
+    }
+    go = true;
+    for (std::thread& thread : threads)
+        thread.join();
+
+    long total = 0;
+    double longest = 0;
+    for (int t = 0; t < num_threads; ++t) {
+        total += samples[t];
+        longest = (elapsed[t] > longest) ? elapsed[t] : longest;
+    }
+    return total / longest;
+}
+
+/* ================================================================== */
+
+// Output files are raw float32, one per benchmark name
+std::string output_path(const std::string& dir, std::string name) {
+    for (char& c : name)
+        c = (c == '/') ? '_' : c;
+    return dir + "/" + name + ".f32";
+}
+
+bool write_output(const std::string& path, const std::vector<float>& rendered) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f)
+        return false;
+    const bool ok = fwrite(rendered.data(), sizeof(float), rendered.size(), f) == rendered.size();
+    return (fclose(f) == 0) && ok;
+}
+
+// Saved output of expected length, false if missing or of other length
+bool read_output(const std::string& path, const size_t count, std::vector<float>& saved) {
+    saved.resize(count + 1);
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f)
+        return false;
+    const size_t read = fread(saved.data(), sizeof(float), saved.size(), f);
+    fclose(f);
+    saved.resize(count);
+    return read == count;
+}
+
+// Max and rms abs difference, NaN in only one of them counts as infinite
+void difference(const std::vector<float>& a, const std::vector<float>& b, double& max_diff, double& rms_diff) {
+    max_diff = rms_diff = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        const bool nan_a = squinewave::is_nan(a[i]), nan_b = squinewave::is_nan(b[i]);
+        const double diff = (nan_a || nan_b) ? ((nan_a == nan_b) ? 0 : HUGE_VAL) : fabs(double(a[i]) - b[i]);
+        max_diff = (diff > max_diff) ? diff : max_diff;
+        rms_diff += diff * diff;
+    }
+    rms_diff = sqrt(rms_diff / (a.size() ? a.size() : 1));
+}
+
+/* ================================================================== */
+
+/* Verification: each optimized kernel against the reference kernel, double precision with
+ * the static fast paths off (run-length segments, sweep table, rotation, cached geometry, see
+ * oscillator::set_fast_paths), so every sample runs the per-sample state machine.
+ * Scenario inputs are control-rate block values. The reference and audio-rate kernels get them as
+ * audio-rate buffers holding the same ramps input_param<double> makes of them, so every kernel
+ * sees the same modulation. Held blocks of those buffers take the fast paths in audio-rate kernels.
+ */
+const int Verify_Length = 1 << 16;      // One FFT frame
+const int64_t Drift_Length = 100000000;
+const double Drift_Freq = 440.3;
+const double Double_Tolerance = 1e-5;    // Max abs error of double kernels
+const double Alias_Margin = 1;           // dB above reference allowed for energy above Nyquist/2
+const double Alias_Floor = -100;         // dB, below this only float noise
+const double Max_Drift = 1;              // Samples between last wraparounds of kernel and reference
+const double Max_Drift_Float = 6;        // SquineF segment ends in float, allow 2^-24 of Drift_Length
+
+/* Ramping block values sit on a coarse grid (2^-6 for freq, 2^-8 for shape),
+ * so each ramp step is exact in the float buffers and the reference sees the very same values.
+ */
+struct verify_scenario
+{
+    const char* name;
+    signal_fn freq;   // Control-rate, one value per block
+    signal_fn clip;
+    signal_fn skew;
+    signal_fn sync;   // Audio-rate, or nullptr
+    double phase;     // init_phase
+    double float_tolerance;  // Max abs error of float kernels, see SquineF help
+};
+
+struct kernel
+{
+    const char* name;
+    bool single;        // Float shape math (SquineF)
+    bool control_rate;  // Freq, clip and skew at control rate, else audio-rate ramps
+    bool per_sample;    // process_sample() one sample at a time, as Squine units at block size 1 (block size 1 only)
+};
+
+// Block values of a scenario, and the reference's audio-rate buffers of their ramps
+struct verify_signals
+{
+    std::vector<float> kr[3], ar[3], sync;
+
+    verify_signals(const verify_scenario& s, int block_size) {
+        const signal_fn* inputs[3] = { &s.freq, &s.clip, &s.skew };
+        const int num_blocks = Verify_Length / block_size;
+        for (int p = 0; p < 3; ++p) {
+            kr[p].resize(num_blocks);
+            ar[p].resize(Verify_Length);
+            for (int b = 0; b < num_blocks; ++b) {
+                kr[p][b] = (*inputs[p])(b * block_size);
+                // As set_target: first block static at the init value, then linear ramps
+                const double start = kr[p][b ? b - 1 : 0];
+                const double delta = kr[p][b] - start;
+                const double c1 = (delta == 0) ? 0 : delta * (1.0 / block_size);
+                for (int n = 0; n < block_size; ++n)
+                    ar[p][b * block_size + n] = float(start + (n + 1) * c1);
+            }
+        }
+        sync.resize(Verify_Length);
+        for (int i = 0; i < Verify_Length; ++i)
+            sync[i] = s.sync ? s.sync(i) : 0;
+    }
+};
+
+// process_sample() of the flags picked at run time, as oscillator::render() picks process()
+template <typename Real, int... Flags>
+void process_sample(squinewave::oscillator<Real>& osc, const int flags, float* sound_out, const float* freq_sig,
+                    const float* clip_sig, const float* skew_sig, const float* sync_sig, std::integer_sequence<int, Flags...>) {
+    typedef squinewave::oscillator<Real> oscillator;
+    typedef void (oscillator::*process_fn)(float* const, float* const, const float*, const float*, const float*, const float*);
+    const process_fn variants[] = { &oscillator::template process_sample<Flags>... };
+    (osc.*variants[flags])(sound_out, nullptr, freq_sig, clip_sig, skew_sig, sync_sig);
+}
+
+template <typename Real>
+void render_verify(const verify_scenario& s, const verify_signals& in, const bool control_rate, const bool fast_paths,
+                   const bool per_sample, const int block_size, std::vector<float>& rendered) {
+    typedef squinewave::oscillator<Real> oscillator;
+    const int flags = (control_rate ? 0 : oscillator::Freq_AR | oscillator::Clip_AR | oscillator::Skew_AR)
+                    | (s.sync ? oscillator::Sync_AR : 0);
+    const std::vector<float>* sig = control_rate ? in.kr : in.ar;
+
+    oscillator osc;
+    osc.init(Sample_Rate, 8.0);
+    osc.set_fast_paths(fast_paths);
+    osc.init_inputs(flags, sig[0].data(), sig[1].data(), sig[2].data(), false);
+    osc.init_phase(s.phase, in.kr[0][0], in.kr[1][0], in.kr[2][0]);
+
+    rendered.resize(Verify_Length);
+    for (int b = 0; b < Verify_Length / block_size; ++b) {
+        const int ar = b * block_size;
+        const int i = control_rate ? b : ar;
+        if (per_sample)
+            process_sample(osc, flags, &rendered[ar], &sig[0][i], &sig[1][i], &sig[2][i], &in.sync[ar],
+                           std::make_integer_sequence<int, oscillator::Num_Process_Variants>());
+        else
+            osc.render(flags, &rendered[ar], nullptr, block_size, &sig[0][i], &sig[1][i], &sig[2][i], &in.sync[ar]);
+    }
+}
+
+// In-place radix-2 FFT, size a power of two
+void fft(std::vector<std::complex<double>>& a) {
+    const size_t n = a.size();
+    for (size_t i = 1, j = 0; i < n; ++i) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+            std::swap(a[i], a[j]);
+    }
+    for (size_t len = 2; len <= n; len <<= 1) {
+        for (size_t k = 0; k < len / 2; ++k) {
+            const std::complex<double> w = std::polar(1.0, -2 * squinewave::pi * k / len);
+            for (size_t i = k; i < n; i += len) {
+                const std::complex<double> u = a[i], v = a[i + len / 2] * w;
+                a[i] = u + v;
+                a[i + len / 2] = u - v;
+            }
+        }
+    }
+}
+
+/* Energy above Nyquist/2 relative to all energy except DC, in dB, Hann window.
+ * Squine aliases when a sweep gets too short for the sample rate, so this rises above the reference
+ * if a fast path shortens sweeps or breaks the Min_Sweep limit.
+ */
+double high_band_energy(const std::vector<float>& x) {
+    const size_t n = x.size();
+    std::vector<std::complex<double>> spectrum(n);
+    for (size_t i = 0; i < n; ++i)
+        spectrum[i] = x[i] * (0.5 - 0.5 * cos(2 * squinewave::pi * i / n));
+    fft(spectrum);
+    double total = 0, high = 0;
+    for (size_t k = 1; k <= n / 2; ++k) {
+        const double energy = std::norm(spectrum[k]);
+        total += energy;
+        high += (k > n / 4) ? energy : 0;
+    }
+    return 10 * log10((high + 1e-30) / (total + 1e-30));
+}
+
+/* Run Drift_Length samples at static inputs with sync output,
+ * and note the first and last wraparounds and their count.
+ */
+template <typename Real>
+void run_drift(const bool control_rate, const bool fast_paths, const int block_size, int64_t& first, int64_t& last, int64_t& wraps) {
+    typedef squinewave::oscillator<Real> oscillator;
+    const int flags = oscillator::Sync_Out | (control_rate ? 0 : oscillator::Freq_AR | oscillator::Clip_AR | oscillator::Skew_AR);
+    const std::vector<float> freq(block_size, float(Drift_Freq)), clip(block_size, 0.6f), skew(block_size, -0.3f);
+    std::vector<float> out(block_size), sync_out(block_size);
+    const float no_sync = 0;
+
+    oscillator osc;
+    osc.init(Sample_Rate, 8.0);
+    osc.set_fast_paths(fast_paths);
+    osc.init_inputs(flags, freq.data(), clip.data(), skew.data(), false);
+    osc.init_phase(1.25, freq[0], clip[0], skew[0]);
+
+    first = last = -1;
+    wraps = 0;
+    for (int64_t done = 0; done < Drift_Length; done += block_size) {
+        const int count = int((Drift_Length - done < block_size) ? Drift_Length - done : block_size);
+        osc.render(flags, out.data(), sync_out.data(), count, freq.data(), clip.data(), skew.data(), &no_sync);
+        for (int i = 0; i < count; ++i) {
+            if (sync_out[i] > 0) {
+                first = (first < 0) ? done + i : first;
+                last = done + i;
+                ++wraps;
+            }
+        }
+    }
+}
+
+// Returns number of failed checks
+int verify(const std::string& filter) {
+    const float Freq_Step = 1.f / 64, Shape_Step = 1.f / 256;
+    // Min_Sweep is 8, so pure sine above 3000 Hz
+    const verify_scenario scenarios[] = {
+        { "static",     constant(440), constant(0.5), constant(0.3), nullptr, 1.25, 2e-3 },
+        { "static_low", constant(31.7f), constant(0.9f), constant(-0.8f), nullptr, 1.25, 2e-3 },
+        { "pure_sine",  constant(9000), constant(1), constant(0.2f), nullptr, 1.25, 1e-4 },
+        { "slow_sweep", constant(30), constant(0), constant(0.2f), nullptr, 1.25, 2e-3 },
+        { "kr_ramp",    quantized(sine(0.5, 200, 300), Freq_Step), quantized(sine(0.3, 0.5, 0.5), Shape_Step),
+                        quantized(sine(0.2, 1, 0), Shape_Step), nullptr, 1.25, 2e-3 },
+        { "kr_tz",      quantized(sine(0.7, 400, 0), Freq_Step), constant(0.7f), constant(0.4f), nullptr, 1.25, 2e-3 },
+        { "hardsync",   constant(100), constant(0.3f), constant(1), impulses(23), 1.25, 1e-4 },
+        { "hardsync_kr", quantized(sine(0.4, 150, 250), Freq_Step), quantized(sine(0.3, 0.4, 0.5), Shape_Step),
+                        constant(-0.5f), impulses(401), 1.25, 1e-4 },
+        // Squine.kr at 750 Hz block rate (48 kHz / 64) with sync Impulse.kr(2), each sample one block:
+        // 2.5 Hz scales to 160 Hz, runs in the */kr/sample kernels as in the unit
+        { "kr_unit_sync", quantized(sine(0.5, 32, 160), Freq_Step), constant(0.8f), constant(0.2f), impulses(375), 1.25, 1e-4 },
+        { "phase_0",    constant(440), constant(0.7f), constant(-0.3f), nullptr, 0, 2e-3 },
+        { "phase_0.5",  constant(440), constant(0.7f), constant(-0.3f), nullptr, 0.5, 2e-3 },
+        { "phase_1",    constant(440), constant(0.7f), constant(-0.3f), nullptr, 1, 2e-3 },
+        { "phase_1.75", constant(440), constant(0.7f), constant(-0.3f), nullptr, 1.75, 2e-3 },
+        { "phase_1.99", constant(440), constant(0.7f), constant(-0.3f), nullptr, 1.99, 2e-3 },
+    };
+    const kernel kernels[] = {
+        { "double/kr", false, true, false },
+        { "double/ar", false, false, false },
+        { "float/ar",  true,  false, false },
+        { "float/kr",  true,  true, false },
+        { "double/kr/sample", false, true, true },
+        { "double/ar/sample", false, false, true },
+        { "float/ar/sample",  true,  false, true },
+        { "float/kr/sample",  true,  true, true },
+    };
+    const int block_sizes[] = { 1, 64 };
+    int failed = 0;
+
+    printf("%-30s %12s %12s %10s %10s\n", "Verify", "max error", "allowed", "HF dB", "ref HF dB");
+    printf("--------------------------------------------------------------------------------\n");
+    for (const verify_scenario& s : scenarios) {
+        for (const int block_size : block_sizes) {
+            const verify_signals in(s, block_size);
+            std::vector<float> reference, rendered;
+            render_verify<double>(s, in, false, false, false, block_size, reference);
+            const double reference_hf = high_band_energy(reference);
+            for (const kernel& k : kernels) {
+                if (k.per_sample && block_size != 1)
+                    continue;
+                const std::string name = std::string(s.name) + "/" + k.name + "/" + std::to_string(block_size);
+                if (name.find(filter) == std::string::npos)
+                    continue;
+                if (k.single)
+                    render_verify<float>(s, in, k.control_rate, true, k.per_sample, block_size, rendered);
+                else
+                    render_verify<double>(s, in, k.control_rate, true, k.per_sample, block_size, rendered);
+                double max_error, rms_error;
+                difference(reference, rendered, max_error, rms_error);
+                const double allowed = k.single ? s.float_tolerance : Double_Tolerance;
+                const double hf = high_band_energy(rendered);
+                const bool ok = (max_error <= allowed) && (hf <= reference_hf + Alias_Margin || hf <= Alias_Floor);
+                failed += !ok;
+                printf("%-30s %12.3g %12.3g %10.1f %10.1f%s\n", name.c_str(), max_error, allowed, hf, reference_hf, ok ? "" : "  FAIL");
+                fflush(stdout);
+            }
+        }
+    }
+
+    // Phase drift at static inputs, kernels against reference, and reference against exact wraparound times
+    if (std::string("drift").find(filter) == std::string::npos)
+        return failed;
+    printf("\n%-30s %12s %12s %12s\n", "Drift over 1e8 samples", "last wrap", "wraps", "drift");
+    printf("--------------------------------------------------------------------------------\n");
+    int64_t ref_first, ref_last, ref_wraps;
+    run_drift<double>(false, false, 64, ref_first, ref_last, ref_wraps);
+    const double period = Sample_Rate / float(Drift_Freq);
+    const double exact_drift = ref_last - (ref_first + (ref_wraps - 1) * period);
+    const bool exact_ok = fabs(exact_drift) <= Max_Drift;
+    failed += !exact_ok;
+    printf("%-30s %12lld %12lld %12.3f%s\n", "reference/exact", (long long)ref_last, (long long)ref_wraps, exact_drift, exact_ok ? "" : "  FAIL");
+    fflush(stdout);
+
+    struct drift_kernel { const char* name; bool single, control_rate; int block_size; };
+    const drift_kernel drift_kernels[] = {
+        { "double/kr", false, true, 64 },
+        { "double/ar", false, false, 64 },
+        { "double/render", false, true, squinewave::oscillator<double>::Render_Chunk },
+        { "float/ar", true, false, 64 },
+        { "float/kr", true, true, 64 },
+    };
+    for (const drift_kernel& k : drift_kernels) {
+        int64_t first, last, wraps;
+        if (k.single)
+            run_drift<float>(k.control_rate, true, k.block_size, first, last, wraps);
+        else
+            run_drift<double>(k.control_rate, true, k.block_size, first, last, wraps);
+        const double drift = double(last - ref_last);
+        const bool ok = (wraps == ref_wraps) && fabs(drift) <= (k.single ? Max_Drift_Float : Max_Drift);
+        failed += !ok;
+        printf("%-30s %12lld %12lld %12.0f%s\n", k.name, (long long)last, (long long)wraps, drift, ok ? "" : "  FAIL");
+        fflush(stdout);
+    }
+    return failed;
+}
+
+} // namespace
+
+/* ================================================================== */
+
+int main(int argc, char* argv[]) {
+    typedef squinewave::oscillator<double> osc;
+#ifdef SQUINE_FTZ
+    const squinewave::denormals_off ftz;
+#endif
+    std::string filter;
+    double min_time = 0.2;
+    int scaling_voices = 0;
+    int max_threads = std::thread::hardware_concurrency();
+    std::string write_dir, compare_dir;
+    double tolerance = 1e-6;
+    double float_factor = 4;
+    bool verify_kernels = false;
+    for (int i = 1; i < argc; ++i) {
+        const bool has_value = i + 1 < argc;
+        if (!strcmp(argv[i], "--verify"))
+            verify_kernels = true;
+        else if (has_value && !strcmp(argv[i], "--filter"))
+            filter = argv[++i];
+        else if (has_value && !strcmp(argv[i], "--min-time"))
+            min_time = atof(argv[++i]);
+        else if (has_value && !strcmp(argv[i], "--scaling"))
+            scaling_voices = atoi(argv[++i]);
+        else if (has_value && !strcmp(argv[i], "--threads"))
+            max_threads = atoi(argv[++i]);
+        else if (has_value && !strcmp(argv[i], "--write-outputs"))
+            write_dir = argv[++i];
+        else if (has_value && !strcmp(argv[i], "--compare-outputs"))
+            compare_dir = argv[++i];
+        else if (has_value && !strcmp(argv[i], "--tolerance"))
+            tolerance = atof(argv[++i]);
+        else if (has_value && !strcmp(argv[i], "--float-factor"))
+            float_factor = atof(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: %s [--filter substring] [--min-time seconds]\n"
+                            "       %s --scaling voices [--threads max] [--min-time seconds]\n"
+                            "       %s [--filter substring] --write-outputs dir\n"
+                            "       %s [--filter substring] --compare-outputs dir [--tolerance max_abs_diff] [--float-factor n]\n"
+                            "       %s [--filter substring] --verify\n",
+                    argv[0], argv[0], argv[0], argv[0], argv[0]);
+            return 1;
+        }
+    }
+
+    if (verify_kernels) {
+        const int failed = verify(filter);
+        printf("%d checks failed\n", failed);
+        return failed ? 1 : 0;
+    }
+
+    const std::vector<scenario> scenarios = bench_scenarios();
+    const int block_sizes[] = { 1, 64, 1024 };
+
+    if (scaling_voices > 0) {
+        const scenario& deep_fm = scenarios[3];
+        printf("%d voices %s, 64-sample blocks, %u hardware threads\n",
+               scaling_voices, deep_fm.name, std::thread::hardware_concurrency());
+        printf("%-8s %14s %9s %11s\n", "threads", "Msamples/s", "speedup", "efficiency");
+        printf("---------------------------------------------\n");
+        double single = 0;
+        for (int threads = 1; threads <= (max_threads > 1 ? max_threads : 1); threads *= 2) {
+            const double rate = run_threads(deep_fm, scaling_voices, threads, min_time);
+            if (threads == 1)
+                single = rate;
+            printf("%-8d %14.2f %9.2f %10.0f%%\n", threads, rate * 1e-6, rate / single, 100 * rate / (single * threads));
+            fflush(stdout);
+        }
+        return 0;
+    }
+
+    const bool outputs = !write_dir.empty() || !compare_dir.empty();
+    int failed = 0;
+    if (!compare_dir.empty()) {
+        printf("%-28s %12s %12s %12s\n", "Benchmark", "max diff", "rms diff", "allowed");
+        printf("------------------------------------------------------------------\n");
+    }
+    else if (!outputs) {
+        printf("%-28s %12s %14s\n", "Benchmark", "ns/sample", "cycles/sample");
+        printf("-------------------------------------------------------\n");
+    }
+    for (const scenario& s : scenarios) {
+        for (const char* precision : { "double", "float" }) {
+            for (const int block_size : block_sizes) {
+                const std::string name = std::string(s.name) + "/" + precision + "/" + std::to_string(block_size);
+                if (name.find(filter) == std::string::npos)
+                    continue;
+                const auto variants = std::make_integer_sequence<int, osc::Num_Process_Variants>();
+                const run_fn run = strcmp(precision, "double") ? select_run<float>(s.flags, variants)
+                                                               : select_run<double>(s.flags, variants);
+                if (outputs) {
+                    std::vector<float> rendered;
+                    run(s, block_size, min_time, &rendered);
+                    double max_diff, rms_diff;
+                    if (!write_dir.empty() && !write_output(output_path(write_dir, name), rendered)) {
+                        fprintf(stderr, "Can't write %s\n", output_path(write_dir, name).c_str());
+                        return 1;
+                    }
+                    if (compare_dir.empty())
+                        continue;
+                    std::vector<float> saved, saved_double;
+                    if (!read_output(output_path(compare_dir, name), rendered.size(), saved)) {
+                        printf("%-28s %12s\n", name.c_str(), "missing");
+                        ++failed;
+                        continue;
+                    }
+                    difference(saved, rendered, max_diff, rms_diff);
+
+                    // Float scenarios are relative to the saved float vs double difference
+                    double allowed = tolerance;
+                    const std::string double_name = std::string(s.name) + "/double/" + std::to_string(block_size);
+                    if (strcmp(precision, "double") && read_output(output_path(compare_dir, double_name), rendered.size(), saved_double)) {
+                        double float_error, unused;
+                        difference(saved, saved_double, float_error, unused);
+                        allowed = (float_factor * float_error > allowed) ? float_factor * float_error : allowed;
+                    }
+                    const bool ok = max_diff <= allowed;
+                    failed += !ok;
+                    printf("%-28s %12.3g %12.3g %12.3g%s\n", name.c_str(), max_diff, rms_diff, allowed, ok ? "" : "  FAIL");
+                    continue;
+                }
+                const result r = run(s, block_size, min_time, nullptr);
+#ifdef SQUINE_BENCH_TSC
+                printf("%-28s %12.2f %14.2f\n", name.c_str(), r.ns_per_sample, r.cycles_per_sample);
+#else
+                printf("%-28s %12.2f %14s\n", name.c_str(), r.ns_per_sample, "-");
+#endif
+                fflush(stdout);
+            }
+        }
+    }
+    if (!compare_dir.empty())
+        printf("%d scenarios above allowed difference\n", failed);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,80 @@
+// Input scenarios of squine_bench, shared with squine_train (PGO training runs of the plugin)
+// by rasmus ekman
+
+#ifndef SQUINE_SCENARIOS_HPP
+#define SQUINE_SCENARIOS_HPP
+
+#include "squinewave.hpp"
+
+#include <cmath>
+#include <functional>
+#include <vector>
+
+namespace squine_scenarios {
+
+const double Sample_Rate = 48000;
+const int Signal_Length = 48000;  // Input signals loop after one second
+
+typedef std::function<float(int)> signal_fn;
+
+inline signal_fn constant(float value) {
+    return [=](int) { return value; };
+}
+
+inline signal_fn sine(double freq, double amp, double offset) {
+    return [=](int t) { return float(offset + amp * sin(2 * squinewave::pi * freq * t / Sample_Rate)); };
+}
+
+// value, with short bursts of NaN and +-Inf
+inline signal_fn bad_values(float value) {
+    return [=](int t) {
+        const int burst = t % 4800;
+        return (burst < 4) ? NAN : (burst < 8) ? INFINITY : (burst < 12) ? -INFINITY : value;
+    };
+}
+
+// f rounded to multiples of step
+inline signal_fn quantized(const signal_fn& f, float step) {
+    return [=](int t) { return step * roundf(f(t) / step); };
+}
+
+// Sample and hold of f, new value every period samples
+inline signal_fn held(const signal_fn& f, int period) {
+    return [=](int t) { return f(t - t % period); };
+}
+
+inline signal_fn impulses(int period) {
+    return [=](int t) { return (t % period) ? 0.f : 1.f; };
+}
+
+struct scenario
+{
+    const char* name;
+    int flags;  // oscillator input rate flags
+    signal_fn freq;
+    signal_fn clip;
+    signal_fn skew;
+    signal_fn sync;
+};
+
+// Benchmark matrix. Min_Sweep is 8, so pure sine above 3000 Hz
+inline std::vector<scenario> bench_scenarios() {
+    typedef squinewave::oscillator<double> osc;
+    return {
+        { "static",    0,                                 constant(440), constant(0.5), constant(0.3), nullptr },
+        { "kr_ramp",   0,                                 sine(0.5, 200, 300), sine(0.3, 0.5, 0.5), sine(0.2, 1, 0), nullptr },
+        { "ar_shape",  osc::Clip_AR | osc::Skew_AR,       constant(220), sine(0.7, 0.5, 0.5), sine(130, 0.9, 0), nullptr },
+        { "deep_fm",   osc::Freq_AR,                      sine(170, 700, 800), constant(0.8), constant(0.2), nullptr },
+        { "tz_fm",     osc::Freq_AR,                      sine(55, 600, 50), constant(0.8), constant(0.4), nullptr },
+        { "full_ar",   osc::Freq_AR | osc::Clip_AR | osc::Skew_AR, sine(110, 300, 400), sine(0.7, 0.5, 0.5), sine(130, 0.9, 0), nullptr },
+        { "hardsync",  osc::Sync_AR,                      constant(100), constant(0.3), constant(1), impulses(23) },
+        { "pure_sine", 0,                                 constant(9000), constant(1), constant(0.2), nullptr },
+        { "slow_sweep", 0,                                constant(30), constant(0), constant(0.2), nullptr },
+        { "bad_shape", osc::Clip_AR | osc::Skew_AR,       constant(330), bad_values(0.7), bad_values(-0.4), nullptr },
+        { "ar_held",   osc::Clip_AR | osc::Skew_AR,       constant(220), held(sine(0.7, 0.5, 0.5), 3000), held(sine(0.3, 0.9, 0), 5000), nullptr },
+    };
+}
+
+} // namespace squine_scenarios
+
+#endif // SQUINE_SCENARIOS_HPP
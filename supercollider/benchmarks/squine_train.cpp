@@ -0,0 +1,206 @@
+// PGO training host for the Squine plugin
+// by rasmus ekman
+//
+// Loads a Squine plugin file and runs Squine and SquineF units over the squine_bench scenarios,
+// the way a server does: constructor, then the calc function once per block.
+// Instrumented plugins (cmake option PGO=GENERATE) record their branch profiles on exit.
+// Each scenario runs at audio rate in 64-sample blocks, also with sync output and 2x oversampling,
+// and at control rate if it has no audio-rate inputs.
+// Built with SUPERNOVA defined to load supernova plugins.
+//
+// Usage: squine_train plugin_file
+
+#include "SC_PlugIn.h"
+#include "squine_scenarios.hpp"
+
+#include <dlfcn.h>
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace squine_scenarios;
+
+const int Block_Size = 64;
+
+struct unit_def
+{
+    std::string name;
+    size_t size;
+    UnitCtorFunc ctor;
+    UnitDtorFunc dtor;
+};
+
+std::vector<unit_def> unit_defs;
+
+int host_print(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    const int count = vfprintf(stderr, format, args);
+    va_end(args);
+    return count;
+}
+
+void* host_alloc(World*, size_t size) {
+    return malloc(size);
+}
+
+void host_free(World*, void* ptr) {
+    free(ptr);
+}
+
+bool host_define_unit(const char* name, size_t size, UnitCtorFunc ctor, UnitDtorFunc dtor, uint32) {
+    unit_defs.push_back({ name, size, ctor, dtor });
+    return true;
+}
+
+bool host_define_unit_cmd(const char*, const char*, UnitCmdFunc) {
+    return true;
+}
+
+void host_clear_outputs(Unit* unit, int count) {
+    for (uint32 i = 0; i < unit->mNumOutputs; ++i)
+        memset(unit->mOutBuf[i], 0, count * sizeof(float));
+}
+
+const unit_def* find_unit(const char* name) {
+    for (const unit_def& def : unit_defs) {
+        if (def.name == name)
+            return &def;
+    }
+    return nullptr;
+}
+
+/* Run one unit over the scenario signals for passes times signal length.
+ * Inputs: freq, clip, skew, sync, iminsweep, initphase, smooth, oversample (as Squine.sc).
+ */
+void run_unit(const unit_def& def, const scenario& s, const bool audio_rate, const int num_outputs,
+              const float oversample, const int passes) {
+    typedef squinewave::oscillator<double> osc;
+    const int block_size = audio_rate ? Block_Size : 1;
+    const int buffer_size = Block_Size;
+
+    Rate full_rate = Rate(), buf_rate = Rate();
+    full_rate.mSampleRate = Sample_Rate;
+    full_rate.mSampleDur = 1 / Sample_Rate;
+    full_rate.mBufLength = Block_Size;
+    buf_rate.mSampleRate = Sample_Rate / Block_Size;
+    buf_rate.mSampleDur = Block_Size / Sample_Rate;
+    buf_rate.mBufLength = 1;
+    World world = World();
+    world.mFullRate = full_rate;
+    world.mBufRate = buf_rate;
+    world.mSampleRate = Sample_Rate;
+    world.mBufLength = Block_Size;
+    Graph graph = Graph();
+
+    // Audio-rate inputs only for units at audio rate, as sclang allows
+    const signal_fn signals[] = { s.freq, s.clip, s.skew, s.sync ? s.sync : constant(0) };
+    const int ar_flags[] = { osc::Freq_AR, osc::Clip_AR, osc::Skew_AR, osc::Sync_AR };
+    const float scalars[] = { 8, 1.25f, 0, oversample };  // iminsweep, initphase, smooth, oversample
+    const int num_inputs = audio_rate ? 8 : 6;
+
+    std::vector<std::vector<float>> in_buffers(num_inputs, std::vector<float>(buffer_size));
+    std::vector<std::vector<float>> out_buffers(num_outputs, std::vector<float>(buffer_size));
+    std::vector<Wire> wires(num_inputs, Wire());
+    std::vector<Wire*> in_wires(num_inputs);
+    std::vector<float*> in_ptrs(num_inputs), out_ptrs(num_outputs);
+    for (int i = 0; i < num_inputs; ++i) {
+        const bool ar = i < 4 && audio_rate && (s.flags & ar_flags[i]);
+        wires[i].mCalcRate = ar ? calc_FullRate : (i < 4) ? calc_BufRate : calc_ScalarRate;
+        if (i >= 4)
+            in_buffers[i][0] = scalars[i - 4];
+        in_wires[i] = &wires[i];
+        in_ptrs[i] = in_buffers[i].data();
+    }
+    for (int i = 0; i < num_outputs; ++i)
+        out_ptrs[i] = out_buffers[i].data();
+
+    // Inputs of the block starting at sample t
+    auto fill = [&](int t) {
+        for (int i = 0; i < 4; ++i) {
+            const int count = (wires[i].mCalcRate == calc_FullRate) ? block_size : 1;
+            for (int k = 0; k < count; ++k)
+                in_buffers[i][k] = signals[i](t + k);
+        }
+    };
+
+    Unit* unit = static_cast<Unit*>(calloc(1, def.size));
+    unit->mWorld = &world;
+    unit->mParent = &graph;
+    unit->mNumInputs = num_inputs;
+    unit->mNumOutputs = num_outputs;
+    unit->mCalcRate = audio_rate ? calc_FullRate : calc_BufRate;
+    unit->mRate = audio_rate ? &world.mFullRate : &world.mBufRate;
+    unit->mBufLength = block_size;
+    unit->mInput = in_wires.data();
+    unit->mInBuf = in_ptrs.data();
+    unit->mOutBuf = out_ptrs.data();
+
+    fill(0);
+    def.ctor(unit);
+    const int signal_blocks = Signal_Length / Block_Size;
+    for (int b = 0; b < passes * signal_blocks; ++b) {
+        // Control-rate units step one block of audio per calc
+        fill((b % signal_blocks) * Block_Size);
+        unit->mCalcFunc(unit, block_size);
+    }
+    if (def.dtor)
+        def.dtor(unit);
+    free(unit);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s plugin_file\n", argv[0]);
+        return 1;
+    }
+    void* plugin = dlopen(argv[1], RTLD_NOW | RTLD_LOCAL);
+    if (!plugin) {
+        fprintf(stderr, "Can't load %s: %s\n", argv[1], dlerror());
+        return 1;
+    }
+    typedef void (*load_fn)(InterfaceTable*);
+    const load_fn load = reinterpret_cast<load_fn>(dlsym(plugin, "load"));
+    if (!load) {
+        fprintf(stderr, "No load function in %s\n", argv[1]);
+        return 1;
+    }
+
+    static InterfaceTable table = InterfaceTable();
+    table.fPrint = host_print;
+    table.fRTAlloc = host_alloc;
+    table.fRTFree = host_free;
+    table.fDefineUnit = host_define_unit;
+    table.fDefineUnitCmd = host_define_unit_cmd;
+    table.fClearUnitOutputs = host_clear_outputs;
+    load(&table);
+
+    // Weighted towards the common case: audio rate, one output, no oversampling
+    typedef squinewave::oscillator<double> osc;
+    const int Audio_Rate_Inputs = osc::Freq_AR | osc::Clip_AR | osc::Skew_AR | osc::Sync_AR;
+    for (const char* name : { "Squine", "SquineF" }) {
+        const unit_def* def = find_unit(name);
+        if (!def) {
+            fprintf(stderr, "No %s in %s\n", name, argv[1]);
+            return 1;
+        }
+        for (const scenario& s : bench_scenarios()) {
+            run_unit(*def, s, true, 1, 1, 4);
+            run_unit(*def, s, true, 2, 1, 1);
+            run_unit(*def, s, true, 1, 2, 1);
+            if (!(s.flags & Audio_Rate_Inputs))
+                run_unit(*def, s, false, 1, 1, 1);
+        }
+        printf("%s: %zu scenarios\n", name, bench_scenarios().size());
+    }
+    // Profiles are written at exit, with the plugin still loaded
+    return 0;
+}
@@ -60,3 +60,15 @@ function(sc_config_compiler_flags target)
         message(WARNING "Unknown compiler: ${CMAKE_CXX_COMPILER_ID}. You may want to modify SuperColliderCompilerConfig.cmake to add checks for SIMD flags and other optimizations.")
     endif()
 endfunction()
+
+# Fast-math profile for one target: reassociation and reciprocals, but NaN/Inf stay IEEE (-fno-finite-math-only),
+# since the Squine input clamps rely on them. SQUINE_FTZ sets FTZ/DAZ explicitly in the code (squinewave::denormals_off):
+# plugins are shared libraries, which don't get the fast-math startup code that sets them.
+function(sc_config_fast_math target)
+    if(CMAKE_CXX_COMPILER_ID MATCHES "Clang|AppleClang|GNU")
+        target_compile_options(${target} PRIVATE -ffast-math -fno-finite-math-only)
+    elseif(CMAKE_CXX_COMPILER_ID MATCHES "MSVC")
+        target_compile_options(${target} PRIVATE /fp:fast)
+    endif()
+    target_compile_definitions(${target} PRIVATE SQUINE_FTZ)
+endfunction()
@@ -2,420 +2,364 @@
 // by rasmus ekman
 
 #include "SC_PlugIn.hpp"
+#include "squinewave.hpp"
 
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+
+/* Only written by PluginLoad. Units keep all mutable state in their own instance,
+ * and any shared tables must be built in PluginLoad and read-only after,
+ * so Squine runs unsynchronized in supernova ParGroups.
+ */
 static InterfaceTable* ft;
 
 namespace ostinato {
+#ifdef SQUINE_ISA
+inline namespace SQUINE_ISA {
+#endif
 
 /* ================================================================== */
 
-class Squine : public SCUnit {
+// Unit wrapper around squinewave::oscillator. Real is double for Squine, float for SquineF.
+template <typename Real>
+class SquineUnit : public SCUnit {
 public:
-    Squine();
+    SquineUnit();
+    ~SquineUnit();
 
-private:
-    /* Allow either static value, or buffer-rate or audio-rate signal.
-     * Buffer-rate values are ramped. (TODO: also smoothing?)
+    /* Unit command "phase" [startphase]: restart the waveform at startphase (range 0-2 as initphase, default 1.25)
+     * from the latest input values, ending any hardsync sweep. For voice reuse without a new node.
      */
-    class input_param
-    {
-        const float*  host_sig = nullptr;
-        double        target = 0;
-        double        value = 0;
-        double        change = 0;
-    public:
-        // Or include whatever needed for std::min
-        inline int min_val(int x, int y) { return x < y ? x : y; }
-
-         // Called at startup to declare host signal
-        void init(const float* host_sig_in, bool is_audiorate)
-        {
-            if (is_audiorate) {
-                host_sig = host_sig_in;
-            }
-            else {
-                host_sig = nullptr;
-                value = host_sig_in[0];
-            }
-        }
+    static void phase_command(SquineUnit* unit, sc_msg_iter* args);
 
-       // Called each process block to refresh host signal
-        void reinit(const float* host_sig_in, int sample_count)
-        {
-            if (host_sig) {
-                host_sig = host_sig_in;
-            }
-            else {
-                set_target(host_sig_in[0], 1. / sample_count);
-            }
-        }
-
-        void check_finished() {
-            if (change && fabs(value - target) <= fabs(change)) {
-                value = target;
-                change = 0;
-            }
-        }
+    /* Unit command "getstate" [replyID]: sends /squine_state nodeID replyID and the state values
+     * phase, sweep_phase, hardsync_phase, hardsync_inc, freq, clip, skew, neg_freq.
+     * Unit command "setstate" [values...] continues from such a state, eg one taken from another Squine.
+     * Missing values are kept as they are.
+     */
+    static void get_state_command(SquineUnit* unit, sc_msg_iter* args);
+    static void set_state_command(SquineUnit* unit, sc_msg_iter* args);
 
-        void set_target(double val, double changerate) {
-            target = val;
-            change = (target - value) * changerate;
-            check_finished();
-        }
+#ifdef SQUINE_STATS
+    /* Unit command "stats" [replyID, reset]: sends /squine_stats nodeID replyID and the counters
+     * (in oscillator::stats order) as a node reply. Nonzero reset clears them after.
+     */
+    static void stats_command(SquineUnit* unit, sc_msg_iter* args);
+#endif
 
-        double get_next(int n) {
-            if (host_sig) {
-                value = host_sig[n];
-                return value;
-            }
-            value += change;
-            check_finished();
-            return value;
-        }
+private:
+    typedef squinewave::oscillator<Real> oscillator;
 
-        double get_current() const {
-            return value;
-        }
+    // Calc function flags: oscillator process flags, plus oversampling or single-sample blocks (never both)
+    enum {
+        Oversampled = oscillator::Num_Process_Variants,
+        Single_Sample = 2 * oscillator::Num_Process_Variants,
+        Num_Calc_Functions = 3 * oscillator::Num_Process_Variants
     };
 
-
-private:
     // Calc function
+    template <int Flags>
     void next(int nSamples);
 
-    void init_phase(const double phase_in, const double freq, const double clip, const double skew);
-    void hardsync_init(const double freq, const double sweep_phase);
-
-    // Input variables
-    input_param freq_param;
-    input_param clip_param;
-    input_param skew_param;
-    bool sync_ar;
-    bool neg_freq;
-
-    // phase and sweep_phase range 0-2. This makes skew/clip into simple proportions
-    double phase;
-    double sweep_phase;
-    double hardsync_phase;
-    double hardsync_inc;
-
-    // Instance constants inited from environment
-    double Min_Sweep;
-    double Maxphase_By_sr;
-    double Max_Sweep_Freq;
-    double Max_Sweep_Inc;
-    double Max_Sync_Freq;
-    double Sync_Phase_Inc;
-};
+    /* freq, clip and skew can play from buffers instead (inputs freqbuf, clipbuf, skewbuf, bufrate).
+     * A param is buffer-driven if its bufnum is >= 0 at start, then it counts as control rate.
+     */
+    enum { Buffer_Inputs = 9, Buffer_Rate_Input = 12 };
+    struct buffer_input
+    {
+        bool on = false;
+        float bufnum = -1;
+        SndBuf* buf = nullptr;
+        squinewave::buffer_track track;
+        float value = 0;
+    };
 
-/* ================================================================== */
+    SndBuf* find_buffer(const float bufnum) const;
+    void read_buffers(int nSamples);
 
-// Returns maxval on Inf or NaN
-static inline double Clamp(const double x, const double minval, const double maxval) {
-    return (x >= minval && x <= maxval) ? x : (x < minval) ? minval : maxval;
-}
+    // Value of an input added after the first release, or default_value if the synthdef has none
+    // (older synthdefs, and kr which only has inputs up to initphase)
+    float optional_input(const int index, const float default_value) const {
+        return (numInputs() > index) ? in0(index) : default_value;
+    }
 
-// Inverted to get proportion flat parts
-#define GET_CLIP(x) (1.0 - Clamp((x),  0.0, 1.0))
-// Rescaled to 0-2, to match phase
-#define GET_SKEW(x) (1.0 - Clamp((x), -1.0, 1.0))
+    // Input signal of param 0-2 (freq, clip, skew): its buffer value or its input
+    const float* param_in(const int param) {
+        return buffer_inputs[param].on ? &buffer_inputs[param].value : in(param);
+    }
 
-/* ================================================================== */
+    template <int... Flags>
+    static UnitCalcFunc calc_function(int flags, std::integer_sequence<int, Flags...>);
 
-Squine::Squine() {
-    const double sr = sampleRate();
+    oscillator osc;
 
-    // Get in param rates
-    freq_param.init(in(0), isAudioRateIn(0));
-    clip_param.init(in(1), isAudioRateIn(1));
-    skew_param.init(in(2), isAudioRateIn(2));
+    // Only allocated in oversampled mode
+    squinewave::oversampler* os = nullptr;
+    float* os_scratch = nullptr;
 
-    sync_ar = isAudioRateIn(3);
-    hardsync_phase = hardsync_inc = 0;
-	neg_freq = (in0(0) < 0);
+    buffer_input buffer_inputs[3];
+    bool has_buffer_inputs = false;
+};
 
-    // Allow range 4-sr/100, randomize if below (eg zero or -1)
-    Min_Sweep = in0(4);
-    if (Min_Sweep < 4 || Min_Sweep > 99) {
-        // Random value range 5-15
-        if (Min_Sweep < 4)
-            Min_Sweep = Clamp(5 * mParent->mRGen->drand() + 5, 5.0, 10);
-        else
-            Min_Sweep = 100;
-        //Print("Min_Sweep: %f\n", Min_Sweep);
-    }
+typedef SquineUnit<double> Squine;
+typedef SquineUnit<float> SquineF;
 
-    Maxphase_By_sr = 2.0 / sr;
-    Max_Sweep_Freq = sr / (2.0 * Min_Sweep);      // range sr/8 - sr/200
-    Max_Sweep_Inc = 1.0 / Min_Sweep;
-    Max_Sync_Freq = sr / (3.0 * log(Min_Sweep));  // range sr/4.1 - sr/13.8
-    Sync_Phase_Inc = 1.0 / log(Min_Sweep);
-
-    // Init phase range 0-2 (which is wraparaound)
-    double startphase = in0(5);
-    if (startphase) {
-        startphase = (startphase < 0 || startphase > 2.0) ? 1.25 : startphase;
-        double freq = fabs(in0(0));
-        double clip = GET_CLIP(in0(1));
-        double skew = GET_SKEW(in0(2));
-        init_phase(startphase, freq, clip, skew);
+/* ================================================================== */
+
+template <typename Real>
+SquineUnit<Real>::SquineUnit() {
+    // Buffer-driven params start at the buffer's first frame
+    for (int param = 0; param < 3; ++param) {
+        buffer_input& b = buffer_inputs[param];
+        b.on = optional_input(Buffer_Inputs + param, -1) >= 0;
+        has_buffer_inputs |= b.on;
+    }
+    if (has_buffer_inputs)
+        read_buffers(0);
+    const float* const freq_in = param_in(0);
+    const float* const clip_in = param_in(1);
+    const float* const skew_in = param_in(2);
+
+    /* Oversampling factor 1, 2 or 4.
+     * At control rate sampleRate() is the block rate, so each call advances the waveform by one block.
+     */
+    const float oversample = (mCalcRate == calc_FullRate) ? optional_input(7, 1) : 1;
+    const int factor = (oversample >= 4) ? 4 : (oversample >= 2) ? 2 : 1;
+    if (factor > 1) {
+        os = static_cast<squinewave::oversampler*>(RTAlloc(mWorld, sizeof(squinewave::oversampler)));
+        os_scratch = static_cast<float*>(RTAlloc(mWorld, squinewave::oversampler::scratch_size(factor, bufferSize()) * sizeof(float)));
+        if (!os || !os_scratch) {
+            Print("Squine: alloc failed, increase server's RT memory (e.g. via ServerOptions)\n");
+            mCalcFunc = ft->fClearUnitOutputs;
+            ClearUnitOutputs(this, 1);
+            mDone = true;
+            return;
+        }
+        new (os) squinewave::oversampler(factor);
+        os->init_inputs(freq_in[0], clip_in[0], skew_in[0]);
     }
 
-    mCalcFunc = make_calc_function<Squine, &Squine::next>();
-    next(1);
+    // Allow range 4-sr/100, randomize if below (eg zero or -1)
+    const double min_sweep = oscillator::pick_min_sweep(in0(4), [this] { return mParent->mRGen->drand(); });
+    osc.init(sampleRate() * factor, min_sweep);
+
+    // Get in param rates, and ramp shape for control-rate params.
+    // At control rate every block is one sample, so a kr sync input (eg Impulse.kr) is read as audio rate.
+    const bool sync_in = isAudioRateIn(3) || (mCalcRate == calc_BufRate && !isScalarRateIn(3));
+    const int flags = ((isAudioRateIn(0) && !buffer_inputs[0].on) ? oscillator::Freq_AR : 0)
+                    | ((isAudioRateIn(1) && !buffer_inputs[1].on) ? oscillator::Clip_AR : 0)
+                    | ((isAudioRateIn(2) && !buffer_inputs[2].on) ? oscillator::Skew_AR : 0)
+                    | (sync_in ? oscillator::Sync_AR : 0)
+                    | ((numOutputs() > 1) ? oscillator::Sync_Out : 0);
+    const bool smooth = optional_input(6, 0) > 0;
+    osc.init_inputs(flags, freq_in, clip_in, skew_in, smooth);
+
+    osc.init_phase(in0(5), freq_in[0], clip_in[0], skew_in[0]);
+
+    // Adaptive iminsweep up to maxsweep (0 is off)
+    const float max_sweep = optional_input(8, 0);
+    if (max_sweep > 0)
+        osc.init_adaptive(max_sweep);
+
+    // Control rate and server block size 1 (eg feedback FM): every block is one sample
+    const int mode = os ? Oversampled : (bufferSize() == 1) ? Single_Sample : 0;
+    mCalcFunc = calc_function(flags | mode, std::make_integer_sequence<int, Num_Calc_Functions>());
+    mCalcFunc(this, 1);
+}
+
+template <typename Real>
+SquineUnit<Real>::~SquineUnit() {
+    if (os)
+        RTFree(mWorld, os);
+    if (os_scratch)
+        RTFree(mWorld, os_scratch);
 }
 
 /* ================================================================== */
 
-// Set main phase so it matches sweep_phase
-void Squine::init_phase(const double phase_in, const double freq, const double clip, const double skew) {
-    const double phase_inc = Maxphase_By_sr * freq;
-    const double min_sweep = phase_inc * Min_Sweep;
-    const double midpoint = Clamp(skew, min_sweep, 2.0 - min_sweep);
-
-    // Init phase range 0-2, has 4 segment parts (sweep down, flat -1, sweep up, flat +1)
-    double phase = 0.0;
-    double sweep_phase = (phase_in >= 0.0)? phase_in : 1.25;  // "up" 0-crossing
-    if (sweep_phase > 2.0)
-        sweep_phase = fmod(sweep_phase, 2.0);
-
-    // Select segment and scale within
-    if (sweep_phase < 1.0) {
-        const double sweep_length = fmax(clip * midpoint, min_sweep);
-        if (sweep_phase < 0.5) {
-            phase = sweep_length * (sweep_phase * 2.0);
-            sweep_phase *= 2.0;
-        }
-        else {
-            const double flat_length = midpoint - sweep_length;
-            phase = sweep_length + flat_length * ((sweep_phase - 0.5) * 2.0);
-            sweep_phase = 1.0;
-        }
+// One specialized calc function per combination of input rates, with or without sync output, oversampling or single-sample blocks
+template <typename Real>
+template <int... Flags>
+UnitCalcFunc SquineUnit<Real>::calc_function(int flags, std::integer_sequence<int, Flags...>) {
+    const UnitCalcFunc calc_functions[] = { make_calc_function<SquineUnit, &SquineUnit::next<Flags>>()... };
+    return calc_functions[flags];
+}
+
+template <typename Real>
+template <int Flags>
+void SquineUnit<Real>::next(int nSamples) {
+    constexpr int Process_Flags = Flags & ~(Oversampled | Single_Sample);
+#ifdef SQUINE_FTZ
+    // FAST_MATH profile: FTZ/DAZ set here, whatever the server thread has
+    const squinewave::denormals_off ftz;
+#endif
+    float* const sync_out = (Flags & oscillator::Sync_Out) ? out(1) : nullptr;
+    if (has_buffer_inputs)
+        read_buffers(nSamples);
+    const float* const freq_in = param_in(0);
+    const float* const clip_in = param_in(1);
+    const float* const skew_in = param_in(2);
+    if (Flags & Single_Sample) {
+        osc.template process_sample<Process_Flags>(out(0), sync_out, freq_in, clip_in, skew_in, in(3));
+    }
+    else if (Flags & Oversampled) {
+        os->template process<Process_Flags>(osc, os_scratch, out(0), sync_out, nSamples, freq_in, clip_in, skew_in, in(3));
     }
     else {
-        const double sweep_length = fmax(clip * (2.0 - midpoint), min_sweep);
-        if (sweep_phase < 1.5) {
-            phase = midpoint + sweep_length * ((sweep_phase - 1.0) * 2.0);
-            sweep_phase = 1.0 + (sweep_phase - 1.0) * 2.0;
-        }
-        else {
-            const double flat_length = 2.0 - (midpoint + sweep_length);
-            phase = midpoint + sweep_length + flat_length * ((sweep_phase - 1.5) * 2.0);
-            sweep_phase = 2.0;
-        }
+        osc.template process<Process_Flags>(out(0), sync_out, nSamples, freq_in, clip_in, skew_in, in(3));
     }
-    this->phase = phase;
-    this->sweep_phase = sweep_phase;
 }
 
-/* ================================================================== */
+// Buffer bufnum of the world, or a LocalBuf of this synth. Nullptr if none.
+template <typename Real>
+SndBuf* SquineUnit<Real>::find_buffer(const float bufnum) const {
+    const uint32 num_buffers = mWorld->mNumSndBufs;
+    if (!(bufnum >= 0 && bufnum < static_cast<float>(num_buffers) + mParent->localBufNum))
+        return nullptr;
+    const uint32 index = static_cast<uint32>(bufnum);
+    return (index < num_buffers) ? mWorld->mSndBufs + index : mParent->mLocalSndBufs + (index - num_buffers);
+}
 
-static inline int32_t find_sync(const float* sync_sig, const int32_t first, const int32_t last)
-{
-    for (int32_t i = first; i < last; ++i) {
-        if (sync_sig[i] >= 1.0)
-            return i;
+/* Values of buffer-driven params at the end of this block, read in place from channel 0.
+ * bufrate is in frames per second. Without a buffer (or an empty one) a param follows its own input.
+ */
+template <typename Real>
+void SquineUnit<Real>::read_buffers(int nSamples) {
+    const float rate = optional_input(Buffer_Rate_Input, 1);
+    const double advance = static_cast<double>(rate) * nSamples * sampleDur();
+    for (int param = 0; param < 3; ++param) {
+        buffer_input& b = buffer_inputs[param];
+        if (!b.on)
+            continue;
+        const float bufnum = in0(Buffer_Inputs + param);
+        if (bufnum != b.bufnum) {
+            b.bufnum = bufnum;
+            b.buf = find_buffer(bufnum);
+        }
+        b.value = in0(param);
+        if (b.buf) {
+            SndBuf* buf = b.buf;
+            LOCK_SNDBUF_SHARED(buf);
+            if (buf->data && buf->frames > 0)
+                b.value = b.track.next(buf->data, buf->frames, buf->channels, advance);
+        }
     }
-    return -1;
 }
 
-/* ================================================================== */
+template <typename Real>
+void SquineUnit<Real>::phase_command(SquineUnit* unit, sc_msg_iter* args) {
+    unit->osc.reset_phase(args->getf(1.25f));
+}
 
-void Squine::hardsync_init(const double freq, const double sweep_phase)
-{
-	static int print;
-    // Ignore sync request if already in hardsync
-    if (this->hardsync_phase)
-        return;
+template <typename Real>
+void SquineUnit<Real>::get_state_command(SquineUnit* unit, sc_msg_iter* args) {
+    const int reply_id = args->geti(-1);
+    const typename oscillator::state state = unit->osc.get_state();
+    // Floats carry phase to 1.2e-7, below a sample step at any audio rate
+    const float values[] = { static_cast<float>(state.phase), static_cast<float>(state.sweep_phase),
+                             static_cast<float>(state.hardsync_phase), static_cast<float>(state.hardsync_inc),
+                             static_cast<float>(state.freq), static_cast<float>(state.clip),
+                             static_cast<float>(state.skew), state.neg_freq ? 1.f : 0.f };
+    SendNodeReply(&unit->mParent->mNode, reply_id, "/squine_state", sizeof(values) / sizeof(float), values);
+}
 
-    // If waveform is on last flat part, we're just done now
-    // (could also start a full spike here, it's an option...)
-    if (sweep_phase == 2.0) {
-        this->phase = 2.0;
-        return;
+template <typename Real>
+void SquineUnit<Real>::set_state_command(SquineUnit* unit, sc_msg_iter* args) {
+    typename oscillator::state state = unit->osc.get_state();
+    state.phase = args->getf(state.phase);
+    state.sweep_phase = args->getf(state.sweep_phase);
+    state.hardsync_phase = args->getf(state.hardsync_phase);
+    state.hardsync_inc = args->getf(state.hardsync_inc);
+    state.freq = args->getf(state.freq);
+    state.clip = args->getf(state.clip);
+    state.skew = args->getf(state.skew);
+    state.neg_freq = args->getf(state.neg_freq ? 1.f : 0.f) != 0;
+    unit->osc.set_state(state);
+}
+
+#ifdef SQUINE_STATS
+template <typename Real>
+void SquineUnit<Real>::stats_command(SquineUnit* unit, sc_msg_iter* args) {
+    const int reply_id = args->geti(-1);
+    const bool reset = args->geti(0) != 0;
+
+    // Counters are exact as floats up to 2^24, use reset for longer runs
+    uint64_t counters[oscillator::Num_Stats];
+    memcpy(counters, &unit->osc.get_stats(), sizeof(counters));
+    float values[oscillator::Num_Stats];
+    for (int i = 0; i < oscillator::Num_Stats; ++i) {
+        values[i] = static_cast<float>(counters[i]);
     }
+    SendNodeReply(&unit->mParent->mNode, reply_id, "/squine_stats", oscillator::Num_Stats, values);
+    if (reset)
+        unit->osc.reset_stats();
+}
+#endif
 
-    if (freq > this->Max_Sync_Freq)
-        return;
+/* ================================================================== */
 
-    this->hardsync_inc = this->Sync_Phase_Inc;
-    this->hardsync_phase = this->hardsync_inc * 0.5;
+// Register units and commands of this build
+void load_units(InterfaceTable* inTable) {
+    ft = inTable;
+    // Build shared read-only tables before any audio thread
+    squinewave::sweep_table<double>::table();
+    squinewave::sweep_table<float>::table();
+    registerUnit<Squine>(ft, "Squine", false);
+    registerUnit<SquineF>(ft, "SquineF", false);
+    DefineUnitCmd("Squine", "phase", Squine::phase_command);
+    DefineUnitCmd("SquineF", "phase", SquineF::phase_command);
+    DefineUnitCmd("Squine", "getstate", Squine::get_state_command);
+    DefineUnitCmd("SquineF", "getstate", SquineF::get_state_command);
+    DefineUnitCmd("Squine", "setstate", Squine::set_state_command);
+    DefineUnitCmd("SquineF", "setstate", SquineF::set_state_command);
+#ifdef SQUINE_STATS
+    DefineUnitCmd("Squine", "stats", Squine::stats_command);
+    DefineUnitCmd("SquineF", "stats", SquineF::stats_command);
+#endif
 }
 
-/* ================================================================== */
+#ifdef SQUINE_ISA
+} // namespace SQUINE_ISA
+#endif
+} // namespace ostinato
 
-void Squine::next(int nSamples) {
-    // Get next input buffer (or kr value)
-    freq_param.reinit(in(0), nSamples);
-    clip_param.reinit(in(1), nSamples);
-    skew_param.reinit(in(2), nSamples);
-
-    // Look for sync if a-rate
-    int32_t sync = sync_ar ? find_sync(in(3), 0, nSamples) : -1;
-
-    float* const sound_out = out(0);
-  /* float* const sync_out = (numOutputs() > 1) ? out(1) : nullptr;
-    if (sync_out) {
-        memset(sync_out, 0, nSamples * sizeof(float));
-    } */
-
-    for (int32_t i = 0; i < nSamples; ++i) {
-		// Just invert negative freqs (run "backwards" by mirroring the waveform)
-        double raw_freq = freq_param.get_next(i);
-        double freq = fabs(raw_freq);
-        double clip = GET_CLIP(clip_param.get_next(i));
-        double skew = GET_SKEW(skew_param.get_next(i));
-
-        // hardsync requested?
-        if (i == sync) {
-            hardsync_init(freq, sweep_phase);
-        }
+/* Instruction set builds (cmake option DISPATCH) include this file with SQUINE_ISA set, eg Squine_avx2.cpp.
+ * Each has its own copy of units and core in namespace SQUINE_ISA, loaded through squine_load_<isa>().
+ * PluginLoad in the baseline build registers the units of the best build the CPU supports.
+ */
+#ifdef SQUINE_ISA
 
-        // hardsync ongoing? Increase freq until wraparound
-        if (hardsync_phase) {
-            const double syncsweep = 0.5 * (1.0 - cos(hardsync_phase));
-            freq += syncsweep * (Max_Sync_Freq - freq);
-            hardsync_phase += hardsync_inc;
-            if (hardsync_phase > pi) {
-                hardsync_phase = pi;
-                hardsync_inc = 0;
-            }
-        }
-	    // Through-Zero modulation: Detect zero-crossings and neg freq
-        {
-	        bool zero_crossing = (raw_freq < 0) != neg_freq;
-			if (zero_crossing) {
-				// Jump to opposite side of waveform
-				phase = 1.5 - phase;
-				if (phase < 0) phase += 2.0;
-				// mirror sweep_phase around 1 (cos rad)
-				sweep_phase = 2.0 - sweep_phase;
-			}
-			neg_freq = (raw_freq < 0);
-			if (neg_freq) {
-				// Invert symmetry for backward waveform
-				skew = Clamp(2.0 - skew, 0.0, 2.0);
-			}
-		}
-
-        const double phase_inc = Maxphase_By_sr * freq;
-
-        // Pure sine if freq > sr / (2 * Min_Sweep)
-        if (freq >= Max_Sweep_Freq) {
-            // Continue from sweep_phase
-            sound_out[i] = static_cast<float>( cos(pi * sweep_phase) );
-            phase = sweep_phase;
-            sweep_phase += phase_inc;
-        }
-        else {
-            const double min_sweep = phase_inc * Min_Sweep;
-            const double midpoint = Clamp(skew, min_sweep, 2.0 - min_sweep);
-
-            // 1st half: Sweep down to cos(sweep_phase <= pi) then flat -1 until phase >= midpoint
-			if (sweep_phase < 1.0) {
-				const double sweep_length = fmax(clip * midpoint, min_sweep);
-
-				sound_out[i] = static_cast<float>( cos(pi * sweep_phase) );
-				sweep_phase += fmin(phase_inc / sweep_length, Max_Sweep_Inc);
-
-				// Handle fractional sweep_phase overshoot after sweep ends
-				if (sweep_phase > 1.0) {
-					/* Tricky here: phase and sweep_phase may disagree where we are in waveform (due to FM + skew/clip changes).
-					 * Sweep_phase dominates to keep waveform stable, waveform (flat part) decides where we are.
-					 */
-					const double flat_length = midpoint - sweep_length;
-					// sweep_phase overshoot scaled to main phase rate
-					const double phase_overshoot = (sweep_phase - 1.0) * sweep_length;
-
-					// phase matches shape
-					phase = midpoint - flat_length + phase_overshoot - phase_inc;
-
-					// Flat if next samp still not at midpoint
-					if (flat_length >= phase_overshoot) {
-						sweep_phase = 1.0;
-						// phase may be > midpoint here (which means actually no flat part),
-						// if so it will be corrected in 2nd half (since sweep_phase == 1.0)
-					}
-					else {
-						const double next_sweep_length = fmax(clip * (2.0 - midpoint), min_sweep);
-						sweep_phase = 1.0 + (phase_overshoot - flat_length) / next_sweep_length;
-					}
-				}
-			}
-			// flat up to midpoint
-			else if (sweep_phase == 1.0 && phase < midpoint) {
-				sound_out[i] = -1.0;
-			}
-            // 2nd half: Sweep up to cos(sweep_phase <= 2.pi) then flat +1 until phase >= 2
-            else if (sweep_phase < 2.0) {
-				const double sweep_length = fmax(clip * (2.0 - midpoint), min_sweep);
-				if (sweep_phase == 1.0) {
-					// sweep_phase overshoot after flat part
-					sweep_phase = 1.0 + fmin( fmin(phase - midpoint, phase_inc) / sweep_length, Max_Sweep_Inc);
-				}
-				sound_out[i] = static_cast<float>( cos(pi * sweep_phase) );
-				sweep_phase += fmin(phase_inc / sweep_length, Max_Sweep_Inc);
-
-				if (sweep_phase > 2.0) {
-					const double flat_length = 2.0 - (midpoint + sweep_length);
-					const double phase_overshoot = (sweep_phase - 2.0) * sweep_length;
-
-					phase = 2.0 - flat_length + phase_overshoot - phase_inc;
-
-					if (flat_length >= phase_overshoot) {
-						sweep_phase = 2.0;
-					}
-					else {
-						const double next_sweep_length = fmax(clip * midpoint, min_sweep);
-						sweep_phase = 2.0 + (phase_overshoot - flat_length) / next_sweep_length;
-					}
-				}
-			}
-			// flat until endpoint
-			else {
-				sound_out[i] = 1.0;
-				sweep_phase = 2.0;
-			}
-        }
+#define SQUINE_PASTE(a, b) a##b
+#define SQUINE_LOAD_FUNCTION(isa) SQUINE_PASTE(squine_load_, isa)
 
-        phase += phase_inc;
-
-        // Phase wraparound
-        if (sweep_phase >= 2.0 && phase >= 2.0)
-        {
-            if (hardsync_phase) {
-                sweep_phase = phase = 0.0;
-                hardsync_phase = hardsync_inc = 0.0;
-
-                sync = find_sync(in(3), i, nSamples);
-            }
-            else {
-                phase -= 2.0;
-                if (phase > phase_inc) {
-                    // wild aliasing freq - just reset
-                    phase = phase_inc * 0.5;
-                }
-                if (freq < Max_Sweep_Freq) {
-                    const double min_sweep = phase_inc * Min_Sweep;
-                    const double midpoint = Clamp(skew, min_sweep, 2.0 - min_sweep);
-                    const double next_sweep_length = fmax(clip * midpoint, min_sweep);
-                    sweep_phase = fmin(phase / next_sweep_length, Max_Sweep_Inc);
-                }
-                else
-                    sweep_phase = phase;
-            }
-
-            //if (sync_out)
-            //    sync_out[i] = 1.0;
-        }
-    }
+void SQUINE_LOAD_FUNCTION(SQUINE_ISA)(InterfaceTable* inTable) {
+    ostinato::load_units(inTable);
 }
 
+#else
 
-} // namespace ostinato
+#ifdef SQUINE_DISPATCH
+void squine_load_avx2(InterfaceTable* inTable);
+
+// AVX2 and FMA supported by CPU and OS. Environment variable SQUINE_ISA=base or avx2 picks a build for testing.
+static bool use_avx2() {
+    __builtin_cpu_init();
+    const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    const char* forced = getenv("SQUINE_ISA");
+    return supported && (!forced || !strcmp(forced, "avx2"));
+}
+#endif
 
 PluginLoad(SquineUGens) {
-    // Plugin magic
-    ft = inTable;
-    registerUnit<ostinato::Squine>(ft, "Squine", false);
+#ifdef SQUINE_DISPATCH
+    if (use_avx2()) {
+        squine_load_avx2(inTable);
+        return;
+    }
+#endif
+    ostinato::load_units(inTable);
 }
+
+#endif
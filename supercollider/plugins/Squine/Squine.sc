@@ -1,5 +1,26 @@
-Squine : UGen {
-    *ar { | freq=440.0, clip=0.0, skew=0.0, sync=0.0, mul=1.0, add=0.0, iminsweep=0, initphase=1.25 |
-        ^this.multiNew('audio', freq, clip, skew, sync, iminsweep, initphase).madd(mul, add)
+Squine : MultiOutUGen {
+    *ar { | freq=440.0, clip=0.0, skew=0.0, sync=0.0, mul=1.0, add=0.0, iminsweep=0, initphase=1.25, smooth=0, oversample=1, maxsweep=0,
+        freqbuf= -1, clipbuf= -1, skewbuf= -1, bufrate=1 |
+        ^this.multiNew('audio', 1, freq, clip, skew, sync, iminsweep, initphase, smooth, oversample, maxsweep,
+            freqbuf, clipbuf, skewbuf, bufrate).madd(mul, add)
+	}
+
+    // One value per control block, iminsweep counts blocks
+    *kr { | freq=440.0, clip=0.0, skew=0.0, sync=0.0, mul=1.0, add=0.0, iminsweep=0, initphase=1.25 |
+        ^this.multiNew('control', 1, freq, clip, skew, sync, iminsweep, initphase).madd(mul, add)
+	}
+
+    // Returns [ sound, sync trigger ]
+    *arSync { | freq=440.0, clip=0.0, skew=0.0, sync=0.0, iminsweep=0, initphase=1.25, smooth=0, oversample=1, maxsweep=0,
+        freqbuf= -1, clipbuf= -1, skewbuf= -1, bufrate=1 |
+        ^this.multiNew('audio', 2, freq, clip, skew, sync, iminsweep, initphase, smooth, oversample, maxsweep,
+            freqbuf, clipbuf, skewbuf, bufrate)
+	}
+
+    init { | numOuts ... theInputs |
+        inputs = theInputs;
+        ^this.initOutputs(numOuts, rate)
 	}
 }
+
+SquineF : Squine {}
@@ -0,0 +1,4 @@
+// Squine built for AVX2 and FMA, loaded by Squine.cpp when the CPU supports them (cmake option DISPATCH)
+
+#define SQUINE_ISA avx2
+#include "Squine.cpp"
@@ -0,0 +1,631 @@
+// Squinewave oscillator bank and unison for Supercollider
+// Many voices in structure-of-arrays form, computed several at once
+// by rasmus ekman
+
+#include "SC_PlugIn.hpp"
+#include "squinewave.hpp"
+
+// Only written by PluginLoad, all mutable state is per unit (safe in supernova ParGroups)
+static InterfaceTable* ft;
+
+namespace ostinato {
+
+/* ================================================================== */
+
+// Voices computed together: one AVX register, or two SSE/NEON registers of floats.
+// The lane loops below have fixed trip count and no branches or calls, so they vectorize.
+static const int Bank_Lanes = 8;
+
+// Per-sample inputs staged for one lane group
+enum { Stage_Freq, Stage_Clip, Stage_Skew, Stage_Sync, Num_Stage_Inputs };
+
+// Voice state and constants for one group of lanes.
+// Same variables as Squine, hardsync_phase is scaled to range 0-1 (not 0-pi).
+struct lane_group
+{
+    float phase[Bank_Lanes];
+    float sweep_phase[Bank_Lanes];
+    float hardsync_phase[Bank_Lanes];
+    float hardsync_inc[Bank_Lanes];
+    float neg_freq[Bank_Lanes];
+
+    // Previous kr input values, ramped from over next block (SquineBank only)
+    float freq[Bank_Lanes];
+    float clip[Bank_Lanes];
+    float skew[Bank_Lanes];
+
+    // Instance constants inited from environment
+    float Min_Sweep[Bank_Lanes];
+    float Max_Sweep_Freq[Bank_Lanes];
+    float Max_Sweep_Inc[Bank_Lanes];
+    float Max_Sync_Freq[Bank_Lanes];
+    float Sync_Phase_Inc[Bank_Lanes];
+};
+
+class SquineBank : public SCUnit {
+public:
+    SquineBank();
+    ~SquineBank();
+
+private:
+    // Calc function
+    void next(int nSamples);
+
+    void stage_group(int group, int nSamples);
+    void next_group(lane_group& group, float* const* outs, int nSamples);
+
+    int voice_input(int param, int voice) const { return 2 + param * numVoices + voice; }
+
+    int numVoices;
+    int numGroups;
+    double Maxphase_By_sr;
+
+    lane_group* groups = nullptr;
+    float* stage = nullptr;      // [sample][Num_Stage_Inputs][Bank_Lanes]
+    float* unused_out = nullptr; // output for padding lanes
+};
+
+/* Unison of Squines around one freq, detuned evenly in pitch over a spread in semitones.
+ * Clip, skew and sync are shared by all voices and decoded once per sample.
+ * Voices run in lane groups with the SquineBank kernel.
+ */
+class SquineUnison : public SCUnit {
+public:
+    SquineUnison();
+    ~SquineUnison();
+
+private:
+    enum { In_Min_Sweep, In_Init_Phase, In_Freq, In_Detune, In_Clip, In_Skew, In_Sync };
+
+    // Calc function
+    void next(int nSamples);
+
+    void stage_shared(int nSamples);
+    void next_group(lane_group& group, const float* ratio, const float* ratio_step, float* const* outs, int nSamples);
+    float detune_ratio(int voice, float detune) const;
+
+    int numVoices;
+    int numGroups;
+    double Maxphase_By_sr;
+
+    // Previous kr input values, ramped from over next block
+    float freq, clip, skew, detune;
+
+    lane_group* groups = nullptr;
+    float* ratio = nullptr;      // [voice] freq ratio at end of last block, zero for padding lanes
+    float* stage = nullptr;      // [Num_Stage_Inputs][sample], clip and skew decoded
+    float* unused_out = nullptr; // output for padding lanes
+};
+
+/* ================================================================== */
+
+/* Lane arithmetic: the kernel is written once for a lane type, either a float (one voice per step)
+ * or with NOVA_SIMD a compiler vector of native register width, which maps to SSE/AVX/NEON.
+ * Masks are bool or all-bits int lanes, and lane_select() replaces branches.
+ */
+static inline float lane_select(bool mask, float a, float b) { return mask ? a : b; }
+static inline bool lane_not(bool mask) { return !mask; }
+static inline float lane_trunc(float x) { return static_cast<float>(static_cast<int32_t>(x)); }
+
+#if defined(NOVA_SIMD) && defined(__GNUC__)
+#ifdef __AVX__
+static const int Lane_Bytes = 32;
+#else
+static const int Lane_Bytes = 16;
+#endif
+typedef float lane_vec __attribute__((vector_size(Lane_Bytes)));
+typedef int32_t lane_mask __attribute__((vector_size(Lane_Bytes)));
+static const int Lane_Width = Lane_Bytes / sizeof(float);
+
+static inline lane_vec lane_select(lane_mask mask, lane_vec a, lane_vec b) {
+    return (lane_vec)((mask & (lane_mask)a) | (~mask & (lane_mask)b));
+}
+static inline lane_mask lane_not(lane_mask mask) { return ~mask; }
+static inline lane_vec lane_trunc(lane_vec x) {
+    return __builtin_convertvector(__builtin_convertvector(x, lane_mask), lane_vec);
+}
+#else
+typedef float lane_vec;
+static const int Lane_Width = 1;
+#endif
+
+template <typename V>
+static inline V lane_load(const float* src) { V x; memcpy(&x, src, sizeof(x)); return x; }
+template <typename V>
+static inline void lane_store(float* dst, V x) { memcpy(dst, &x, sizeof(x)); }
+template <typename V>
+static inline V lane_const(float x) { return V{} + x; }
+
+// NaN in a gives b, like fmin/fmax with NaN in first arg
+template <typename V> static inline V lane_min(V a, V b) { return lane_select(a < b, a, b); }
+template <typename V> static inline V lane_max(V a, V b) { return lane_select(a > b, a, b); }
+template <typename V> static inline V lane_abs(V x) { return lane_select(x < lane_const<V>(0), -x, x); }
+
+// Returns maxval on Inf or NaN
+template <typename V>
+static inline V lane_clamp(V x, V lo, V hi) {
+    return lane_select((x >= lo) & (x <= hi), x, lane_select(x < lo, lo, hi));
+}
+
+// Shape inputs as the kernel takes them, as GET_CLIP / GET_SKEW in Squine
+template <typename V>
+static inline V decode_clip(V x) { return 1.0f - lane_clamp(x, lane_const<V>(0.0f), lane_const<V>(1.0f)); }
+template <typename V>
+static inline V decode_skew(V x) { return 1.0f - lane_clamp(x, lane_const<V>(-1.0f), lane_const<V>(1.0f)); }
+
+/* Branch-free cos(pi * x), as squinewave::cos_pi with SQUINE_FAST_COS: reduced by symmetry
+ * to the core sin(pi * y) polynomial. Integer truncation (not floor) keeps the range reduction vectorizable with SSE2.
+ */
+template <typename V>
+static inline V cos_pi(V x) {
+    x = lane_abs(x);
+    x -= lane_const<V>(2.0f) * lane_trunc(x * 0.5f);
+    x = lane_select(x > lane_const<V>(1.0f), 2.0f - x, x);
+    return squinewave::sin_pi_poly<V, float>(0.5f - x);
+}
+
+/* ================================================================== */
+
+/* Constants and start phase for one voice, as in Squine constructor and oscillator::init_phase.
+ * Min_Sweep is already in range 4-100, freq, clip and skew are the raw inputs.
+ * Voice phase is float here (double in Squine), see the drift note in SquineBank help.
+ */
+static void init_lane(lane_group& group, int lane, double sr, double Min_Sweep, double startphase,
+                      double freq, double clip, double skew) {
+    const double Maxphase_By_sr = 2.0 / sr;
+
+    group.neg_freq[lane] = (freq < 0) ? 1.0f : 0.0f;
+    group.Min_Sweep[lane] = Min_Sweep;
+    group.Max_Sweep_Freq[lane] = sr / (2.0 * Min_Sweep);
+    group.Max_Sweep_Inc[lane] = 1.0 / Min_Sweep;
+    group.Max_Sync_Freq[lane] = sr / (3.0 * log(Min_Sweep));
+    group.Sync_Phase_Inc[lane] = 1.0 / (log(Min_Sweep) * pi);
+
+    const double phase_inc = Maxphase_By_sr * fabs(freq);
+    double phase, sweep_phase;
+    squinewave::start_phase(startphase, phase_inc * Min_Sweep, squinewave::get_clip(clip), squinewave::get_skew(skew),
+                            phase, sweep_phase);
+    group.phase[lane] = phase;
+    group.sweep_phase[lane] = sweep_phase;
+}
+
+/* ================================================================== */
+
+SquineBank::SquineBank() {
+    const double sr = sampleRate();
+    Maxphase_By_sr = 2.0 / sr;
+
+    numVoices = numOutputs();
+    numGroups = (numVoices + Bank_Lanes - 1) / Bank_Lanes;
+
+    groups = static_cast<lane_group*>(RTAlloc(mWorld, numGroups * sizeof(lane_group)));
+    stage = static_cast<float*>(RTAlloc(mWorld, bufferSize() * Num_Stage_Inputs * Bank_Lanes * sizeof(float)));
+    unused_out = static_cast<float*>(RTAlloc(mWorld, bufferSize() * sizeof(float)));
+    if (!groups || !stage || !unused_out) {
+        Print("SquineBank: alloc failed, increase server's RT memory (e.g. via ServerOptions)\n");
+        mCalcFunc = ft->fClearUnitOutputs;
+        ClearUnitOutputs(this, 1);
+        mDone = true;
+        return;
+    }
+    memset(groups, 0, numGroups * sizeof(lane_group));
+
+    // Allow range 4-100, randomize per voice if below (eg zero or -1)
+    const double min_sweep = in0(0);
+
+    // Init phase range 0-2 (which is wraparaound)
+    double startphase = in0(1);
+    startphase = (startphase < 0 || startphase > 2.0) ? 1.25 : startphase;
+
+    for (int v = 0; v < numVoices; ++v) {
+        lane_group& group = groups[v / Bank_Lanes];
+        const int lane = v % Bank_Lanes;
+        group.freq[lane] = in0(voice_input(Stage_Freq, v));
+        group.clip[lane] = in0(voice_input(Stage_Clip, v));
+        group.skew[lane] = in0(voice_input(Stage_Skew, v));
+        const double voice_min_sweep = squinewave::oscillator<double>::pick_min_sweep(
+            min_sweep, [this] { return mParent->mRGen->drand(); });
+        init_lane(group, lane, sr, voice_min_sweep, startphase, group.freq[lane], group.clip[lane], group.skew[lane]);
+    }
+    // Padding lanes run silently at zero freq
+    for (int v = numVoices; v < numGroups * Bank_Lanes; ++v) {
+        init_lane(groups[v / Bank_Lanes], v % Bank_Lanes, sr, 100, 0, 0, 0, 0);
+    }
+
+    mCalcFunc = make_calc_function<SquineBank, &SquineBank::next>();
+    next(1);
+}
+
+SquineBank::~SquineBank() {
+    if (groups)
+        RTFree(mWorld, groups);
+    if (stage)
+        RTFree(mWorld, stage);
+    if (unused_out)
+        RTFree(mWorld, unused_out);
+}
+
+/* ================================================================== */
+
+// Gather inputs of one lane group into contiguous lanes per sample.
+// Audio-rate inputs are copied, buffer-rate inputs are ramped from previous value.
+void SquineBank::stage_group(int g, int nSamples) {
+    lane_group& group = groups[g];
+    float* const prev[Num_Stage_Inputs] = { group.freq, group.clip, group.skew, nullptr };
+    const float ramp_rate = 1.0f / nSamples;
+
+    for (int lane = 0; lane < Bank_Lanes; ++lane) {
+        const int v = g * Bank_Lanes + lane;
+        for (int param = 0; param < Num_Stage_Inputs; ++param) {
+            float* dst = stage + param * Bank_Lanes + lane;
+            const int stride = Num_Stage_Inputs * Bank_Lanes;
+
+            if (v >= numVoices) {
+                for (int i = 0; i < nSamples; ++i)
+                    dst[i * stride] = 0;
+                continue;
+            }
+            const int index = voice_input(param, v);
+            const float* src = in(index);
+            if (isAudioRateIn(index)) {
+                for (int i = 0; i < nSamples; ++i)
+                    dst[i * stride] = src[i];
+            }
+            else if (prev[param]) {
+                const float value = prev[param][lane];
+                const float change = (src[0] - value) * ramp_rate;
+                for (int i = 0; i < nSamples; ++i)
+                    dst[i * stride] = value + change * (i + 1);
+                prev[param][lane] = src[0];
+            }
+            else {
+                // Sync only at audio rate, as in Squine
+                for (int i = 0; i < nSamples; ++i)
+                    dst[i * stride] = 0;
+            }
+        }
+    }
+}
+
+/* ================================================================== */
+
+void SquineBank::next(int nSamples) {
+    float* outs[Bank_Lanes];
+
+    for (int g = 0; g < numGroups; ++g) {
+        for (int lane = 0; lane < Bank_Lanes; ++lane) {
+            const int v = g * Bank_Lanes + lane;
+            outs[lane] = (v < numVoices) ? out(v) : unused_out;
+        }
+        stage_group(g, nSamples);
+        next_group(groups[g], outs, nSamples);
+    }
+}
+
+/* ================================================================== */
+
+/* Same segment logic as Squine::next, with the branch ladder replaced by lane masks:
+ * every lane computes every segment candidate, and selects by its own state.
+ * Clip and skew come decoded (decode_clip/decode_skew), so units can decode shared inputs once.
+ */
+template <typename V>
+static inline V squine_lanes(const int l, const float maxphase_by_sr,
+                             const V raw_freq, const V clip, V skew, const V sync_in,
+                             float* phase, float* sweep_phase, float* hardsync_phase, float* hardsync_inc, float* neg_freq,
+                             const float* Min_Sweep, const float* Max_Sweep_Freq, const float* Max_Sweep_Inc,
+                             const float* Max_Sync_Freq, const float* Sync_Phase_Inc)
+{
+    const V zero = lane_const<V>(0.0f), one = lane_const<V>(1.0f), two = lane_const<V>(2.0f);
+    const V max_sweep_inc = lane_load<V>(Max_Sweep_Inc + l);
+    const V max_sync_freq = lane_load<V>(Max_Sync_Freq + l);
+
+    const auto negative = raw_freq < zero;
+    V freq = lane_abs(raw_freq);
+    V ph = lane_load<V>(phase + l);
+    V sp = lane_load<V>(sweep_phase + l);
+    V hs = lane_load<V>(hardsync_phase + l);
+    V hs_inc = lane_load<V>(hardsync_inc + l);
+
+    // hardsync requested? (ignored if already in hardsync)
+    const auto sync = (sync_in >= one) & (hs == zero);
+    const auto sync_done = sync & (sp == two);
+    const auto sync_start = sync & lane_not(sp == two) & (freq <= max_sync_freq);
+    ph = lane_select(sync_done, two, ph);
+    hs_inc = lane_select(sync_start, lane_load<V>(Sync_Phase_Inc + l), hs_inc);
+    hs = lane_select(sync_start, hs_inc * 0.5f, hs);
+
+    // hardsync ongoing? Increase freq until wraparound
+    const auto in_sync_sweep = hs != zero;
+    const V syncsweep = 0.5f * (1.0f - cos_pi(hs));
+    freq = lane_select(in_sync_sweep, freq + syncsweep * (max_sync_freq - freq), freq);
+    hs = lane_select(in_sync_sweep, hs + hs_inc, hs);
+    const auto sync_sweep_end = hs > one;
+    hs = lane_select(sync_sweep_end, one, hs);
+    hs_inc = lane_select(sync_sweep_end, zero, hs_inc);
+
+    // Through-Zero modulation: mirror waveform on zero-crossing
+    const V was_negative = lane_load<V>(neg_freq + l);
+    const auto zero_crossing = negative ^ (was_negative != zero);
+    V mirrored = 1.5f - ph;
+    mirrored = lane_select(mirrored < zero, mirrored + 2.0f, mirrored);
+    ph = lane_select(zero_crossing, mirrored, ph);
+    sp = lane_select(zero_crossing, 2.0f - sp, sp);
+    lane_store(neg_freq + l, lane_select(negative, one, zero));
+    skew = lane_select(negative, lane_clamp(2.0f - skew, zero, two), skew);
+
+    const V phase_inc = maxphase_by_sr * freq;
+    const V min_sweep = phase_inc * lane_load<V>(Min_Sweep + l);
+    const V midpoint = lane_clamp(skew, min_sweep, 2.0f - min_sweep);
+    const V sweep_length_1 = lane_max(clip * midpoint, min_sweep);
+    const V sweep_length_2 = lane_max(clip * (2.0f - midpoint), min_sweep);
+
+    // Segment masks, pure sine if freq > sr / (2 * Min_Sweep)
+    const auto pure = freq >= lane_load<V>(Max_Sweep_Freq + l);
+    const auto live = lane_not(pure);
+    const auto sweep_1 = live & (sp < one);
+    const auto flat_1 = live & (sp == one) & (ph < midpoint);
+    const auto sweep_2 = live & lane_not(sweep_1 | flat_1) & (sp < two);
+    const auto any_sweep = sweep_1 | sweep_2;
+
+    // sweep_phase overshoot after flat part
+    const V flat_overshoot = lane_min(lane_min(ph - midpoint, phase_inc) / sweep_length_2, max_sweep_inc);
+    sp = lane_select(sweep_2 & (sp == one), 1.0f + flat_overshoot, sp);
+
+    const V sound = lane_select(pure | any_sweep, cos_pi(sp), lane_select(flat_1, -one, one));
+
+    // Advance sweep_phase
+    const V sweep_length = lane_select(sweep_1, sweep_length_1, sweep_length_2);
+    const V sweep_inc = lane_min(phase_inc / sweep_length, max_sweep_inc);
+    ph = lane_select(pure, sp, ph);
+    V next_sp = lane_select(pure, sp + phase_inc,
+                lane_select(any_sweep, sp + sweep_inc, lane_select(flat_1, sp, two)));
+
+    // Fractional sweep_phase overshoot after 1st sweep ends
+    const auto end_1 = sweep_1 & (next_sp > one);
+    const V flat_length_1 = midpoint - sweep_length_1;
+    const V overshoot_1 = (next_sp - 1.0f) * sweep_length_1;
+    const V next_sp_1 = lane_select(flat_length_1 >= overshoot_1, one, 1.0f + (overshoot_1 - flat_length_1) / sweep_length_2);
+    ph = lane_select(end_1, midpoint - flat_length_1 + overshoot_1 - phase_inc, ph);
+    next_sp = lane_select(end_1, next_sp_1, next_sp);
+
+    // ...and after 2nd sweep
+    const auto end_2 = sweep_2 & (next_sp > two);
+    const V flat_length_2 = 2.0f - (midpoint + sweep_length_2);
+    const V overshoot_2 = (next_sp - 2.0f) * sweep_length_2;
+    const V next_sp_2 = lane_select(flat_length_2 >= overshoot_2, two, 2.0f + (overshoot_2 - flat_length_2) / sweep_length_1);
+    ph = lane_select(end_2, 2.0f - flat_length_2 + overshoot_2 - phase_inc, ph);
+    next_sp = lane_select(end_2, next_sp_2, next_sp);
+
+    sp = next_sp;
+    ph += phase_inc;
+
+    // Phase wraparound, restarts from zero after hardsync
+    const auto wrap = (sp >= two) & (ph >= two);
+    const auto wrap_sync = wrap & (hs != zero);
+    const auto wrap_free = wrap & (hs == zero);
+    V wrapped = ph - 2.0f;
+    // wild aliasing freq - just reset
+    wrapped = lane_select(wrapped > phase_inc, phase_inc * 0.5f, wrapped);
+    const V wrapped_sp = lane_select(pure, wrapped, lane_min(wrapped / sweep_length_1, max_sweep_inc));
+    ph = lane_select(wrap_sync, zero, lane_select(wrap_free, wrapped, ph));
+    sp = lane_select(wrap_sync, zero, lane_select(wrap_free, wrapped_sp, sp));
+    hs = lane_select(wrap_sync, zero, hs);
+    hs_inc = lane_select(wrap_sync, zero, hs_inc);
+
+    lane_store(phase + l, ph);
+    lane_store(sweep_phase + l, sp);
+    lane_store(hardsync_phase + l, hs);
+    lane_store(hardsync_inc + l, hs_inc);
+    return sound;
+}
+
+/* ================================================================== */
+
+void SquineBank::next_group(lane_group& group, float* const* outs, int nSamples) {
+    const float maxphase_by_sr = Maxphase_By_sr;
+
+    for (int i = 0; i < nSamples; ++i) {
+        const float* const staged = stage + i * Num_Stage_Inputs * Bank_Lanes;
+        float sound[Bank_Lanes];
+
+        for (int l = 0; l < Bank_Lanes; l += Lane_Width) {
+            const lane_vec x = squine_lanes<lane_vec>(l, maxphase_by_sr,
+                lane_load<lane_vec>(staged + Stage_Freq * Bank_Lanes + l),
+                decode_clip(lane_load<lane_vec>(staged + Stage_Clip * Bank_Lanes + l)),
+                decode_skew(lane_load<lane_vec>(staged + Stage_Skew * Bank_Lanes + l)),
+                lane_load<lane_vec>(staged + Stage_Sync * Bank_Lanes + l),
+                group.phase, group.sweep_phase, group.hardsync_phase, group.hardsync_inc, group.neg_freq,
+                group.Min_Sweep, group.Max_Sweep_Freq, group.Max_Sweep_Inc, group.Max_Sync_Freq, group.Sync_Phase_Inc);
+            lane_store(sound + l, x);
+        }
+
+        for (int l = 0; l < Bank_Lanes; ++l)
+            outs[l][i] = sound[l];
+    }
+}
+
+/* ================================================================== */
+
+SquineUnison::SquineUnison() {
+    const double sr = sampleRate();
+    Maxphase_By_sr = 2.0 / sr;
+
+    numVoices = numOutputs();
+    numGroups = (numVoices + Bank_Lanes - 1) / Bank_Lanes;
+
+    groups = static_cast<lane_group*>(RTAlloc(mWorld, numGroups * sizeof(lane_group)));
+    ratio = static_cast<float*>(RTAlloc(mWorld, numGroups * Bank_Lanes * sizeof(float)));
+    stage = static_cast<float*>(RTAlloc(mWorld, bufferSize() * Num_Stage_Inputs * sizeof(float)));
+    unused_out = static_cast<float*>(RTAlloc(mWorld, bufferSize() * sizeof(float)));
+    if (!groups || !ratio || !stage || !unused_out) {
+        Print("SquineUnison: alloc failed, increase server's RT memory (e.g. via ServerOptions)\n");
+        mCalcFunc = ft->fClearUnitOutputs;
+        ClearUnitOutputs(this, 1);
+        mDone = true;
+        return;
+    }
+    memset(groups, 0, numGroups * sizeof(lane_group));
+
+    freq = in0(In_Freq);
+    clip = in0(In_Clip);
+    skew = in0(In_Skew);
+    detune = in0(In_Detune);
+
+    // Init phase range 0-2 (which is wraparaound)
+    double startphase = in0(In_Init_Phase);
+    startphase = (startphase < 0 || startphase > 2.0) ? 1.25 : startphase;
+
+    /* Allow range 4-100. If below (eg zero or -1), spread voices over 5-10: one random value
+     * in each of numVoices equal steps, dealt to voices in random order so detune and Min_Sweep
+     * are unrelated. Voices then never share the quieter bands of the spectrum (see Squine help).
+     */
+    const double min_sweep = in0(In_Min_Sweep);
+    for (int v = 0; v < numVoices; ++v) {
+        groups[v / Bank_Lanes].Min_Sweep[v % Bank_Lanes] = (min_sweep < 4) ? 5 + 5 * (v + mParent->mRGen->drand()) / numVoices
+                                                          : (min_sweep > 99) ? 100 : min_sweep;
+    }
+    for (int v = numVoices - 1; v > 0; --v) {
+        const int other = static_cast<int>(mParent->mRGen->drand() * (v + 1)) % (v + 1);
+        float& a = groups[v / Bank_Lanes].Min_Sweep[v % Bank_Lanes];
+        float& b = groups[other / Bank_Lanes].Min_Sweep[other % Bank_Lanes];
+        const float swap = a;
+        a = b;
+        b = swap;
+    }
+
+    for (int v = 0; v < numVoices; ++v) {
+        lane_group& group = groups[v / Bank_Lanes];
+        const int lane = v % Bank_Lanes;
+        ratio[v] = detune_ratio(v, detune);
+        init_lane(group, lane, sr, group.Min_Sweep[lane], startphase, freq * ratio[v], clip, skew);
+    }
+    // Padding lanes run silently at zero freq
+    for (int v = numVoices; v < numGroups * Bank_Lanes; ++v) {
+        ratio[v] = 0;
+        init_lane(groups[v / Bank_Lanes], v % Bank_Lanes, sr, 100, 0, 0, 0, 0);
+    }
+
+    mCalcFunc = make_calc_function<SquineUnison, &SquineUnison::next>();
+    next(1);
+}
+
+SquineUnison::~SquineUnison() {
+    if (groups)
+        RTFree(mWorld, groups);
+    if (ratio)
+        RTFree(mWorld, ratio);
+    if (stage)
+        RTFree(mWorld, stage);
+    if (unused_out)
+        RTFree(mWorld, unused_out);
+}
+
+/* ================================================================== */
+
+// Freq ratio of a voice, spread evenly in pitch over detune semitones, centered on 1
+float SquineUnison::detune_ratio(int voice, float detune) const {
+    if (numVoices < 2)
+        return 1.0f;
+    const double position = double(voice) / (numVoices - 1) - 0.5;
+    return static_cast<float>(exp2(detune * position / 12.0));
+}
+
+// Shared inputs per sample, as SquineBank::stage_group for one voice. Clip and skew are decoded here, once.
+void SquineUnison::stage_shared(int nSamples) {
+    float* const dst_freq = stage + Stage_Freq * nSamples;
+    float* const dst_clip = stage + Stage_Clip * nSamples;
+    float* const dst_skew = stage + Stage_Skew * nSamples;
+    float* const dst_sync = stage + Stage_Sync * nSamples;
+    const float ramp_rate = 1.0f / nSamples;
+
+    float* const prev[] = { &freq, &clip, &skew };
+    const int inputs[] = { In_Freq, In_Clip, In_Skew };
+    float* const dsts[] = { dst_freq, dst_clip, dst_skew };
+    for (int param = 0; param < 3; ++param) {
+        const float* src = in(inputs[param]);
+        float* dst = dsts[param];
+        if (isAudioRateIn(inputs[param])) {
+            for (int i = 0; i < nSamples; ++i)
+                dst[i] = src[i];
+        }
+        else {
+            const float value = *prev[param];
+            const float change = (src[0] - value) * ramp_rate;
+            for (int i = 0; i < nSamples; ++i)
+                dst[i] = value + change * (i + 1);
+            *prev[param] = src[0];
+        }
+    }
+    for (int i = 0; i < nSamples; ++i) {
+        dst_clip[i] = decode_clip(dst_clip[i]);
+        dst_skew[i] = decode_skew(dst_skew[i]);
+    }
+
+    // Sync only at audio rate, as in Squine
+    const float* sync = in(In_Sync);
+    const bool sync_ar = isAudioRateIn(In_Sync);
+    for (int i = 0; i < nSamples; ++i)
+        dst_sync[i] = sync_ar ? sync[i] : 0;
+}
+
+void SquineUnison::next(int nSamples) {
+    float* outs[Bank_Lanes];
+    float ratio_target[Bank_Lanes];
+    float ratio_step[Bank_Lanes];
+
+    stage_shared(nSamples);
+
+    // Detune is control rate: ratios ramp to the new spread over the block
+    const float new_detune = in0(In_Detune);
+    const bool detune_changed = new_detune != detune;
+    detune = new_detune;
+
+    for (int g = 0; g < numGroups; ++g) {
+        float* const group_ratio = ratio + g * Bank_Lanes;
+        for (int lane = 0; lane < Bank_Lanes; ++lane) {
+            const int v = g * Bank_Lanes + lane;
+            outs[lane] = (v < numVoices) ? out(v) : unused_out;
+            ratio_target[lane] = (v < numVoices && detune_changed) ? detune_ratio(v, detune) : group_ratio[lane];
+            ratio_step[lane] = (ratio_target[lane] - group_ratio[lane]) / nSamples;
+        }
+        next_group(groups[g], group_ratio, ratio_step, outs, nSamples);
+        memcpy(group_ratio, ratio_target, sizeof(ratio_target));
+    }
+}
+
+void SquineUnison::next_group(lane_group& group, const float* ratio, const float* ratio_step, float* const* outs, int nSamples) {
+    const float maxphase_by_sr = Maxphase_By_sr;
+    const float* const in_freq = stage + Stage_Freq * nSamples;
+    const float* const in_clip = stage + Stage_Clip * nSamples;
+    const float* const in_skew = stage + Stage_Skew * nSamples;
+    const float* const in_sync = stage + Stage_Sync * nSamples;
+
+    for (int i = 0; i < nSamples; ++i) {
+        float sound[Bank_Lanes];
+        const lane_vec clip = lane_const<lane_vec>(in_clip[i]);
+        const lane_vec skew = lane_const<lane_vec>(in_skew[i]);
+        const lane_vec sync = lane_const<lane_vec>(in_sync[i]);
+        const float k = static_cast<float>(i + 1);
+
+        for (int l = 0; l < Bank_Lanes; l += Lane_Width) {
+            const lane_vec voice_ratio = lane_load<lane_vec>(ratio + l) + lane_load<lane_vec>(ratio_step + l) * k;
+            const lane_vec x = squine_lanes<lane_vec>(l, maxphase_by_sr, in_freq[i] * voice_ratio, clip, skew, sync,
+                group.phase, group.sweep_phase, group.hardsync_phase, group.hardsync_inc, group.neg_freq,
+                group.Min_Sweep, group.Max_Sweep_Freq, group.Max_Sweep_Inc, group.Max_Sync_Freq, group.Sync_Phase_Inc);
+            lane_store(sound + l, x);
+        }
+
+        for (int l = 0; l < Bank_Lanes; ++l)
+            outs[l][i] = sound[l];
+    }
+}
+
+
+} // namespace ostinato
+
+PluginLoad(SquineBankUGens) {
+    // Plugin magic
+    ft = inTable;
+    registerUnit<ostinato::SquineBank>(ft, "SquineBank", false);
+    registerUnit<ostinato::SquineUnison>(ft, "SquineUnison", false);
+}
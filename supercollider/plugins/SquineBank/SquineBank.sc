@@ -0,0 +1,16 @@
+SquineBank : MultiOutUGen {
+    *ar { | freq=#[440.0], clip=0.0, skew=0.0, sync=0.0, mul=1.0, add=0.0, iminsweep=0, initphase=1.25 |
+        var numVoices = freq.asArray.size;
+        ^this.multiNewList(['audio', iminsweep, initphase]
+            ++ freq.asArray
+            ++ clip.asArray.wrapExtend(numVoices)
+            ++ skew.asArray.wrapExtend(numVoices)
+            ++ sync.asArray.wrapExtend(numVoices)
+        ).madd(mul, add)
+	}
+
+    init { | ... theInputs |
+        inputs = theInputs;
+        ^this.initOutputs((inputs.size - 2) div: 4, rate)
+    }
+}
@@ -0,0 +1,10 @@
+SquineUnison : MultiOutUGen {
+    *ar { | numVoices=7, freq=440.0, detune=0.2, clip=0.0, skew=0.0, sync=0.0, mul=1.0, add=0.0, iminsweep=0, initphase=1.25 |
+        ^this.multiNew('audio', numVoices, iminsweep, initphase, freq, detune, clip, skew, sync).madd(mul, add)
+	}
+
+    init { | numVoices ... theInputs |
+        inputs = theInputs;
+        ^this.initOutputs(numVoices, rate)
+    }
+}
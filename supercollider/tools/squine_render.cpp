@@ -0,0 +1,214 @@
+// Offline renderer for the Squinewave oscillator core
+// by rasmus ekman
+//
+// Renders one Squine to a 32-bit float WAV file, with the whole run in one oscillator::render() call.
+// Each input is a constant, or @file for a raw mono float32 signal (native byte order) at the output rate.
+//
+// Usage: squine_render [options] out.wav
+//   --rate hz          sample rate (default 48000)
+//   --duration secs    length (default 1, or the shortest input file)
+//   --freq v|@file     frequency in Hz (default 440)
+//   --clip v|@file     squareness 0-1 (default 0)
+//   --skew v|@file     symmetry -1 to 1 (default 0)
+//   --sync @file       hardsync signal, triggers at >= 1.0
+//   --min-sweep n      minimum sweep length 4-100, below 4 is random 5-10 (default 0)
+//   --phase p          initial phase 0-2 (default 1.25)
+//   --seed n           random seed for min-sweep (default 1)
+//   --float            single precision shape math (SquineF)
+//   --sync-out         write sync trigger output as second channel
+
+#include "squinewave.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// One input: a constant, or a signal read from file
+struct input
+{
+    float value = 0;
+    std::vector<float> signal;
+
+    bool is_signal() const { return !signal.empty(); }
+    const float* data() const { return is_signal() ? signal.data() : &value; }
+
+    bool parse(const char* arg) {
+        if (arg[0] != '@') {
+            char* end;
+            value = strtof(arg, &end);
+            return *end == 0;
+        }
+        FILE* f = fopen(arg + 1, "rb");
+        if (!f) {
+            fprintf(stderr, "Can't open input %s\n", arg + 1);
+            return false;
+        }
+        float buffer[4096];
+        size_t count;
+        while ((count = fread(buffer, sizeof(float), 4096, f)) > 0)
+            signal.insert(signal.end(), buffer, buffer + count);
+        fclose(f);
+        if (signal.empty()) {
+            fprintf(stderr, "Empty input %s\n", arg + 1);
+            return false;
+        }
+        return true;
+    }
+};
+
+void put_u32(FILE* f, uint32_t x) {
+    const unsigned char bytes[4] = { uint8_t(x), uint8_t(x >> 8), uint8_t(x >> 16), uint8_t(x >> 24) };
+    fwrite(bytes, 1, 4, f);
+}
+
+void put_u16(FILE* f, uint16_t x) {
+    const unsigned char bytes[2] = { uint8_t(x), uint8_t(x >> 8) };
+    fwrite(bytes, 1, 2, f);
+}
+
+// WAVE_FORMAT_IEEE_FLOAT, little-endian header. Samples are written in native order (little-endian hosts).
+bool write_wav(const char* path, const std::vector<float>& samples, int channels, uint32_t rate) {
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "Can't open output %s\n", path);
+        return false;
+    }
+    const uint32_t data_size = uint32_t(samples.size() * sizeof(float));
+    fwrite("RIFF", 1, 4, f);
+    put_u32(f, 36 + data_size);
+    fwrite("WAVEfmt ", 1, 8, f);
+    put_u32(f, 16);
+    put_u16(f, 3);
+    put_u16(f, uint16_t(channels));
+    put_u32(f, rate);
+    put_u32(f, rate * channels * sizeof(float));
+    put_u16(f, uint16_t(channels * sizeof(float)));
+    put_u16(f, 32);
+    fwrite("data", 1, 4, f);
+    put_u32(f, data_size);
+    const bool ok = fwrite(samples.data(), sizeof(float), samples.size(), f) == samples.size();
+    return (fclose(f) == 0) && ok;
+}
+
+struct options
+{
+    double rate = 48000;
+    double duration = 0;
+    input freq, clip, skew, sync;
+    double min_sweep = 0;
+    double phase = 1.25;
+    unsigned seed = 1;
+    bool sync_out = false;
+};
+
+template <typename Real>
+void render(const options& opt, const int64_t frames, std::vector<float>& sound, std::vector<float>& triggers) {
+    typedef squinewave::oscillator<Real> oscillator;
+    std::mt19937 rng(opt.seed);
+    std::uniform_real_distribution<double> uniform(0, 1);
+
+    const int flags = (opt.freq.is_signal() ? oscillator::Freq_AR : 0)
+                    | (opt.clip.is_signal() ? oscillator::Clip_AR : 0)
+                    | (opt.skew.is_signal() ? oscillator::Skew_AR : 0)
+                    | (opt.sync.is_signal() ? oscillator::Sync_AR : 0)
+                    | (opt.sync_out ? oscillator::Sync_Out : 0);
+
+    oscillator osc;
+    osc.init(opt.rate, oscillator::pick_min_sweep(opt.min_sweep, [&] { return uniform(rng); }));
+    osc.init_inputs(flags, opt.freq.data(), opt.clip.data(), opt.skew.data(), false);
+    osc.init_phase(opt.phase, opt.freq.data()[0], opt.clip.data()[0], opt.skew.data()[0]);
+
+    sound.resize(frames);
+    triggers.resize(opt.sync_out ? frames : 0);
+    osc.render(flags, sound.data(), opt.sync_out ? triggers.data() : nullptr, frames,
+               opt.freq.data(), opt.clip.data(), opt.skew.data(), opt.sync.data());
+}
+
+int usage(const char* name) {
+    fprintf(stderr, "Usage: %s [--rate hz] [--duration secs] [--freq v|@file] [--clip v|@file] [--skew v|@file]\n"
+                    "       [--sync @file] [--min-sweep n] [--phase p] [--seed n] [--float] [--sync-out] out.wav\n", name);
+    return 1;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    options opt;
+    opt.freq.value = 440;
+    bool single = false;
+    const char* out_path = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        bool ok = true;
+        if (arg == "--float")
+            single = true;
+        else if (arg == "--sync-out")
+            opt.sync_out = true;
+        else if (arg[0] != '-' && !out_path)
+            out_path = argv[i];
+        else if (!has_value)
+            ok = false;
+        else if (arg == "--rate")
+            opt.rate = atof(argv[++i]);
+        else if (arg == "--duration")
+            opt.duration = atof(argv[++i]);
+        else if (arg == "--freq")
+            ok = opt.freq.parse(argv[++i]);
+        else if (arg == "--clip")
+            ok = opt.clip.parse(argv[++i]);
+        else if (arg == "--skew")
+            ok = opt.skew.parse(argv[++i]);
+        else if (arg == "--sync")
+            ok = opt.sync.parse(argv[++i]) && opt.sync.is_signal();
+        else if (arg == "--min-sweep")
+            opt.min_sweep = atof(argv[++i]);
+        else if (arg == "--phase")
+            opt.phase = atof(argv[++i]);
+        else if (arg == "--seed")
+            opt.seed = unsigned(atol(argv[++i]));
+        else
+            ok = false;
+        if (!ok)
+            return usage(argv[0]);
+    }
+    if (!out_path || opt.rate < 1)
+        return usage(argv[0]);
+
+    // Length of the shortest input file, unless duration is given
+    int64_t frames = int64_t(opt.duration * opt.rate);
+    int64_t shortest = -1;
+    for (const input* in : { &opt.freq, &opt.clip, &opt.skew, &opt.sync }) {
+        if (in->is_signal() && (shortest < 0 || int64_t(in->signal.size()) < shortest))
+            shortest = int64_t(in->signal.size());
+    }
+    if (opt.duration <= 0)
+        frames = (shortest >= 0) ? shortest : int64_t(opt.rate);
+    if (shortest >= 0 && frames > shortest) {
+        fprintf(stderr, "Input files hold %lld samples, %lld requested\n", (long long)shortest, (long long)frames);
+        return 1;
+    }
+
+    std::vector<float> sound, triggers;
+    if (single)
+        render<float>(opt, frames, sound, triggers);
+    else
+        render<double>(opt, frames, sound, triggers);
+
+    std::vector<float> interleaved;
+    if (opt.sync_out) {
+        interleaved.resize(2 * frames);
+        for (int64_t i = 0; i < frames; ++i) {
+            interleaved[2 * i] = sound[i];
+            interleaved[2 * i + 1] = triggers[i];
+        }
+    }
+    return write_wav(out_path, opt.sync_out ? interleaved : sound, opt.sync_out ? 2 : 1, uint32_t(opt.rate)) ? 0 : 1;
+}